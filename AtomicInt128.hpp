@@ -0,0 +1,231 @@
+/* AtomicInt128.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Lock free atomic Int128 using cmpxchg16b, for (pointer, version) pairs and
+128 bit counters shared between threads.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_ATOMICINT128_H
+#define NIALLSCPP11UTILITIES_ATOMICINT128_H
+
+/*! \file AtomicInt128.hpp
+\brief Provides the AtomicInt128 lock free atomic and std::atomic<Int128>
+*/
+
+#include "Int128_256.hpp"
+#include <atomic>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/*! \def HAVE_CMPXCHG16B
+\brief Turns on support for the lock cmpxchg16b instruction
+*/
+#ifndef HAVE_CMPXCHG16B
+#if defined(_M_X64) || defined(__x86_64__)
+#define HAVE_CMPXCHG16B 1
+#else
+#define HAVE_CMPXCHG16B 0
+#endif
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	enum atomic_int128_features
+	{
+		atomic_int128_have_cx16=1,	//!< lock cmpxchg16b is available
+		atomic_int128_have_avx=2	//!< Aligned 16 byte loads and stores are atomic
+	};
+	//! Returns which atomic_int128_features this CPU has
+	inline int atomic_int128_cpu_features()
+	{
+#if HAVE_CMPXCHG16B
+		static int features=-1;
+		if(features<0)
+		{
+			unsigned c;
+#ifdef _MSC_VER
+			int regs[4];
+			__cpuid(regs, 1);
+			c=(unsigned) regs[2];
+#else
+			unsigned a, b, d;
+			if(!__get_cpuid(1, &a, &b, &c, &d)) c=0;
+#endif
+			// Intel and AMD both guarantee that 16 byte aligned SSE loads and stores are atomic on CPUs with AVX
+			features=((c>>13)&1 ? atomic_int128_have_cx16 : 0)|((c>>28)&1 ? atomic_int128_have_avx : 0);
+		}
+		return features;
+#else
+		return 0;
+#endif
+	}
+	//! Returns the spinlock guarding \em p when the CPU cannot do 128 bit atomics
+	inline std::atomic<unsigned char> &atomic_int128_lock(const volatile void *p)
+	{
+		static std::atomic<unsigned char> locks[64];
+		return locks[(((size_t) p)>>4)&63];
+	}
+}
+
+/*! \class AtomicInt128
+\brief An Int128 which may be atomically loaded, stored, exchanged and compare exchanged. WILL throw exception if initialised unaligned.
+
+On x86-64 all operations are lock free using lock cmpxchg16b, with loads and stores using plain aligned SSE moves
+on CPUs with AVX where those are documented as atomic. Elsewhere a small table of spinlocks is used, and is_lock_free()
+returns false. As lock cmpxchg16b is a full barrier, all memory orders are treated as std::memory_order_seq_cst
+except that loads on AVX CPUs are only as strong as the x86 memory model (which is all the C++ memory model needs).
+*/
+class TYPEALIGNMENT(16) AtomicInt128
+{
+	volatile unsigned long long mydata[2];
+	void int_testAlignment() const
+	{
+#ifndef NDEBUG
+		if(((size_t)this) & 15) throw std::runtime_error("This object must be aligned to 16 bytes in memory!");
+#endif
+	}
+	static unsigned long long *int_longlongs(const Int128 &v) { return const_cast<unsigned long long *>(v.asLongLongs()); }
+	// Compare exchanges, updating expected with the old value on failure
+	bool int_cas(Int128 &expected, const Int128 &desired) volatile
+	{
+		unsigned long long *e=int_longlongs(expected);
+		const unsigned long long *d=desired.asLongLongs();
+#if HAVE_CMPXCHG16B
+		if(Impl::atomic_int128_cpu_features() & Impl::atomic_int128_have_cx16)
+		{
+#ifdef _MSC_VER
+			return 0!=_InterlockedCompareExchange128((volatile __int64 *) mydata, (__int64) d[1], (__int64) d[0], (__int64 *) e);
+#else
+			bool ret;
+			__asm__ __volatile__("lock cmpxchg16b %1\n\tsete %0"
+				: "=q"(ret), "+m"(mydata[0]), "+a"(e[0]), "+d"(e[1])
+				: "b"(d[0]), "c"(d[1])
+				: "memory", "cc");
+			return ret;
+#endif
+		}
+#endif
+		std::atomic<unsigned char> &lock=Impl::atomic_int128_lock(this);
+		while(lock.exchange(1, std::memory_order_acquire));
+		bool ret=(mydata[0]==e[0] && mydata[1]==e[1]);
+		if(ret)
+		{
+			mydata[0]=d[0];
+			mydata[1]=d[1];
+		}
+		else
+		{
+			e[0]=mydata[0];
+			e[1]=mydata[1];
+		}
+		lock.store(0, std::memory_order_release);
+		return ret;
+	}
+public:
+	//! Constructs a zero atomic
+	AtomicInt128() { int_testAlignment(); mydata[0]=mydata[1]=0; }
+	//! Constructs an atomic with an initial value. Initialisation is not atomic.
+	AtomicInt128(const Int128 &v) { int_testAlignment(); mydata[0]=v.asLongLongs()[0]; mydata[1]=v.asLongLongs()[1]; }
+	AtomicInt128(const AtomicInt128 &) = delete;
+	AtomicInt128 &operator=(const AtomicInt128 &) = delete;
+	AtomicInt128 &operator=(const AtomicInt128 &) volatile = delete;
+	//! True if operations never take a lock
+	bool is_lock_free() const volatile { return 0!=(Impl::atomic_int128_cpu_features() & Impl::atomic_int128_have_cx16); }
+	//! Atomically returns the value
+	Int128 load(std::memory_order order=std::memory_order_seq_cst) const volatile
+	{
+		Int128 ret;
+#if HAVE_CMPXCHG16B
+		if(Impl::atomic_int128_cpu_features() & Impl::atomic_int128_have_avx)
+		{
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			_mm_store_si128((__m128i *) int_longlongs(ret), _mm_load_si128((const __m128i *) mydata));
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			return ret;
+		}
+#endif
+		// A compare exchange of zero with zero returns the current value without changing it
+		const_cast<AtomicInt128 *>(this)->int_cas(ret, ret);
+		return ret;
+	}
+	//! Atomically sets the value
+	void store(const Int128 &v, std::memory_order order=std::memory_order_seq_cst) volatile
+	{
+#if HAVE_CMPXCHG16B
+		if(Impl::atomic_int128_cpu_features() & Impl::atomic_int128_have_avx)
+		{
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			_mm_store_si128((__m128i *) mydata, _mm_load_si128((const __m128i *) v.asLongLongs()));
+			if(std::memory_order_seq_cst==order)
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			return;
+		}
+#endif
+		exchange(v, order);
+	}
+	//! Atomically sets the value, returning the previous value
+	Int128 exchange(const Int128 &v, std::memory_order order=std::memory_order_seq_cst) volatile
+	{
+		Int128 ret(load(std::memory_order_relaxed));
+		while(!int_cas(ret, v));
+		return ret;
+	}
+	//! Atomically sets the value to \em desired if it equals \em expected, else updates \em expected with the value
+	bool compare_exchange_strong(Int128 &expected, const Int128 &desired, std::memory_order order=std::memory_order_seq_cst) volatile
+	{
+		return int_cas(expected, desired);
+	}
+	//! Atomically sets the value to \em desired if it equals \em expected, else updates \em expected with the value
+	bool compare_exchange_strong(Int128 &expected, const Int128 &desired, std::memory_order success, std::memory_order failure) volatile
+	{
+		return int_cas(expected, desired);
+	}
+	//! As compare_exchange_strong(), as lock cmpxchg16b never fails spuriously
+	bool compare_exchange_weak(Int128 &expected, const Int128 &desired, std::memory_order order=std::memory_order_seq_cst) volatile
+	{
+		return int_cas(expected, desired);
+	}
+	//! As compare_exchange_strong(), as lock cmpxchg16b never fails spuriously
+	bool compare_exchange_weak(Int128 &expected, const Int128 &desired, std::memory_order success, std::memory_order failure) volatile
+	{
+		return int_cas(expected, desired);
+	}
+	//! Atomically adds \em v to the value treated as a little endian unsigned 128 bit integer, returning the previous value
+	Int128 fetch_add(unsigned long long v, std::memory_order order=std::memory_order_seq_cst) volatile
+	{
+		Int128 ret(load(std::memory_order_relaxed)), desired;
+		unsigned long long *d=int_longlongs(desired);
+		do
+		{
+			const unsigned long long *r=ret.asLongLongs();
+			d[0]=r[0]+v;
+			d[1]=r[1]+(d[0]<r[0]);
+		} while(!int_cas(ret, desired));
+		return ret;
+	}
+	//! Atomically returns the value
+	operator Int128() const volatile { return load(); }
+	//! Atomically sets the value
+	Int128 operator=(const Int128 &v) volatile { store(v); return v; }
+};
+
+} // namespace
+
+namespace std
+{
+	//! Defines a lock free (on x86-64) atomic for a Int128
+	template<> struct atomic<NiallsCPP11Utilities::Int128> : public NiallsCPP11Utilities::AtomicInt128
+	{
+		atomic() { }
+		atomic(const NiallsCPP11Utilities::Int128 &v) : NiallsCPP11Utilities::AtomicInt128(v) { }
+		using NiallsCPP11Utilities::AtomicInt128::operator=;
+	};
+}
+
+#endif
@@ -0,0 +1,479 @@
+/* ConsistentHashing.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Jump consistent hash, weighted rendezvous hash and a bounded load consistent
+hash ring for routing digests to buckets with minimal remapping.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_CONSISTENTHASHING_H
+#define NIALLSCPP11UTILITIES_CONSISTENTHASHING_H
+
+/*! \file ConsistentHashing.hpp
+\brief Provides jumpConsistentHash(), the WeightedRendezvousHash and the BoundedLoadHashRing
+*/
+
+#include "DigestFilters.hpp"
+#include "SimdBitset.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	//! Returns the first 64 bit word of a digest of at least 128 bits, which is what all the routers route by
+	template<class K> inline unsigned long long routing_word(const K &k)
+	{
+		unsigned long long w0, w1;
+		digest_filter_words(k, w0, w1);
+		return w0;
+	}
+	//! The SplitMix64 finaliser
+	inline unsigned long long routing_mix64(unsigned long long z)
+	{
+		z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+		z=(z^(z>>27))*0x94d049bb133111ebULL;
+		return z^(z>>31);
+	}
+	//! The MurmurHash3 finaliser
+	inline unsigned routing_mix32(unsigned x)
+	{
+		x^=x>>16;
+		x*=0x85ebca6bU;
+		x^=x>>13;
+		x*=0xc2b2ae35U;
+		return x^(x>>16);
+	}
+	//! Lamping and Veach's jump consistent hash of a 64 bit key, where \em buckets must be at least one
+	inline unsigned jump_consistent_hash(unsigned long long key, unsigned buckets)
+	{
+		long long b=-1, j=0;
+		while(j<(long long) buckets)
+		{
+			b=j;
+			key=key*2862933555777941757ULL+1;
+			j=(long long)((b+1)*(double(1LL<<31)/double((key>>33)+1)));
+		}
+		return (unsigned) b;
+	}
+#if HAVE_M256
+	// Converts four 64 bit integers below 2^52 to doubles exactly
+	inline __m256d routing_epi64_pd(__m256i v)
+	{
+		const __m256d magic=_mm256_set1_pd(4503599627370496.0);
+		return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, _mm256_castpd_si256(magic))), magic);
+	}
+	// Returns four jump consistent hashes, identical to jump_consistent_hash() as buckets is at least one
+	inline __m128i jump_consistent_hash4(__m256i key, unsigned buckets)
+	{
+		const __m256i klo=_mm256_set1_epi64x(0x87b0b0fd), khi=_mm256_set1_epi64x(0x27bb2ee6), one=_mm256_set1_epi64x(1);
+		const __m256d two31=_mm256_set1_pd(double(1LL<<31)), n=_mm256_set1_pd((double) buckets), magic=_mm256_set1_pd(4503599627370496.0);
+		__m256d b=_mm256_setzero_pd(), active=_mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		// As key is multiplied modulo 2^64 the cross terms only need their low 32 bits
+		do
+		{
+			__m256i cross=_mm256_add_epi64(_mm256_mul_epu32(key, khi), _mm256_mul_epu32(_mm256_srli_epi64(key, 32), klo));
+			key=_mm256_add_epi64(_mm256_add_epi64(_mm256_mul_epu32(key, klo), _mm256_slli_epi64(cross, 32)), one);
+			__m256d d=routing_epi64_pd(_mm256_add_epi64(_mm256_srli_epi64(key, 33), one));
+			__m256d j=_mm256_mul_pd(_mm256_add_pd(b, _mm256_set1_pd(1)), _mm256_div_pd(two31, d));
+			active=_mm256_and_pd(_mm256_cmp_pd(j, n, _CMP_LT_OQ), active);
+			b=_mm256_blendv_pd(b, _mm256_round_pd(j, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC), active);
+		} while(_mm256_movemask_pd(active));
+		// The buckets are exact integers below 2^31, so adding 2^52 leaves them in the low mantissa bits
+		__m256i r=_mm256_castpd_si256(_mm256_add_pd(b, magic));
+		return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(r, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+	}
+#endif
+}
+
+/*! \brief Returns which of \em buckets buckets a Hash128/Hash256/Int128/Int256 (or their Ref views) routes to using
+Lamping and Veach (2014) "A Fast, Minimal Memory, Consistent Hash Algorithm".
+
+When the number of buckets grows from \em n to \em n+1 only 1/(n+1) of keys move, all to the new bucket, and no
+memory is needed. Buckets can only be added or removed at the end. The key is the first 64 bit word of the digest,
+and takes approx. ln(\em buckets) iterations, each with a double division. Throws std::invalid_argument if there are
+no buckets.
+*/
+template<class K> inline unsigned jumpConsistentHash(const K &key, unsigned buckets)
+{
+	if(!buckets) throw std::invalid_argument("jumpConsistentHash needs at least one bucket");
+	return Impl::jump_consistent_hash(Impl::routing_word(key), buckets);
+}
+/*! \brief Routes \em no keys to \em buckets buckets with jumpConsistentHash(), writing the buckets to \em results.
+
+On AVX2 four keys are iterated at a time, with the 64 bit multiply done as three 32 bit multiplies and the divisions
+in four double lanes, until all four are done. Results are identical to jumpConsistentHash(). Throws
+std::invalid_argument if there are no buckets. On an Intel Xeon virtual machine this costs approx. 12ns per key for 10 buckets and 30ns for 10,000 buckets with
+AVX2, and approx. 35ns and 80ns without.
+*/
+template<class K> inline void jumpConsistentHash(size_t no, const K *keys, unsigned buckets, unsigned *results)
+{
+	if(!buckets) throw std::invalid_argument("jumpConsistentHash needs at least one bucket");
+	size_t n=0;
+#if HAVE_M256
+	for(; n+4<=no; n+=4)
+	{
+		__m256i k=_mm256_set_epi64x((long long) Impl::routing_word(keys[n+3]), (long long) Impl::routing_word(keys[n+2]), (long long) Impl::routing_word(keys[n+1]), (long long) Impl::routing_word(keys[n]));
+		_mm_storeu_si128((__m128i *)(results+n), Impl::jump_consistent_hash4(k, buckets));
+	}
+#endif
+	for(; n<no; n++)
+		results[n]=jumpConsistentHash(keys[n], buckets);
+}
+
+/*! \class WeightedRendezvousHash
+\brief Routes Hash128/Hash256/Int128/Int256 (or their Ref views) to weighted buckets by highest random weight.
+
+Implements the logarithmic method of Schindelhauer and Schomaker (2005) "Weighted Distributed Hash Tables": each
+bucket scores -log(u)/weight for a uniform u hashed from the key and the bucket's id, and the lowest score wins, so
+each bucket receives keys in proportion to its weight. Adding or removing a bucket only moves the keys which route to
+or from it. Buckets are identified by caller chosen 64 bit ids and routing returns the id.
+
+Every route scores every bucket, so routing is O(buckets). The scoring is deterministic across builds and platforms
+as the logarithm is a fixed point approximation done in integer arithmetic (within 0.008 of log2), and the only
+floating point operation is a single rounded multiply by the reciprocal weight. On AVX2 eight buckets are scored at a
+time, else the same calculation is scalar.
+On an Intel Xeon virtual machine routing costs approx. 1.3ns per key per bucket with AVX2 and 6ns without.
+*/
+class WeightedRendezvousHash
+{
+	std::vector<unsigned long long> myids;
+	std::vector<double> myweights;
+	// Padded to a multiple of eight with buckets of infinite reciprocal weight, which never win
+	std::vector<unsigned, aligned_allocator<unsigned, 32>> myseeds;
+	std::vector<float, aligned_allocator<float, 32>> myinvweights;
+	static unsigned int_key(unsigned long long w0) { return (unsigned)(w0^(w0>>32)); }
+	// Returns -log2 of the hash of key and seed in Q23 fixed point, so in (0, 24]
+	static int int_logscore(unsigned key, unsigned seed)
+	{
+		unsigned v=(Impl::routing_mix32(key^seed)>>8)|1, bits;
+		float f=(float)(int) v;
+		memcpy(&bits, &f, sizeof(bits));
+		// The exponent is the integer part of log2(v), and the mantissa plus a quadratic correction the fraction
+		unsigned m=bits & 0x7fffff, m15=m>>8, e=(bits>>23)-127;
+		return (int)((24U<<23)-((e<<23)+m+((((m15*(32768-m15))>>15)*354)>>2)));
+	}
+	void int_rebuild()
+	{
+		size_t padded=(myids.size()+7)&~(size_t) 7;
+		myseeds.assign(padded, 0);
+		myinvweights.assign(padded, std::numeric_limits<float>::infinity());
+		for(size_t n=0; n<myids.size(); n++)
+		{
+			myseeds[n]=(unsigned) Impl::routing_mix64(myids[n]);
+			myinvweights[n]=(float)(1.0/myweights[n]);
+		}
+	}
+	size_t int_route(unsigned long long w0) const
+	{
+		unsigned key=int_key(w0);
+		float best=std::numeric_limits<float>::infinity();
+		size_t bestidx=0, n=0;
+#if HAVE_M256
+		const __m256i mask23=_mm256_set1_epi32(0x7fffff), c354=_mm256_set1_epi32(354), c32768=_mm256_set1_epi32(32768);
+		const __m256i bias=_mm256_set1_epi32(127), top=_mm256_set1_epi32(24<<23), one=_mm256_set1_epi32(1), eight=_mm256_set1_epi32(8);
+		const __m256i k=_mm256_set1_epi32((int) key);
+		__m256i idx=_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), bestidxs=idx;
+		__m256 bests=_mm256_set1_ps(best);
+		for(; n<myseeds.size(); n+=8)
+		{
+			__m256i x=_mm256_xor_si256(k, _mm256_load_si256((const __m256i *)(myseeds.data()+n)));
+			x=_mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+			x=_mm256_mullo_epi32(x, _mm256_set1_epi32((int) 0x85ebca6bU));
+			x=_mm256_xor_si256(x, _mm256_srli_epi32(x, 13));
+			x=_mm256_mullo_epi32(x, _mm256_set1_epi32((int) 0xc2b2ae35U));
+			x=_mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+			__m256i bits=_mm256_castps_si256(_mm256_cvtepi32_ps(_mm256_or_si256(_mm256_srli_epi32(x, 8), one)));
+			__m256i m=_mm256_and_si256(bits, mask23), m15=_mm256_srli_epi32(m, 8);
+			__m256i corr=_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(m15, _mm256_sub_epi32(c32768, m15)), 15), c354), 2);
+			__m256i logv=_mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), bias), 23), m), corr);
+			__m256 score=_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(top, logv)), _mm256_load_ps(myinvweights.data()+n));
+			__m256 lt=_mm256_cmp_ps(score, bests, _CMP_LT_OQ);
+			bests=_mm256_blendv_ps(bests, score, lt);
+			bestidxs=_mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestidxs), _mm256_castsi256_ps(idx), lt));
+			idx=_mm256_add_epi32(idx, eight);
+		}
+		TYPEALIGNMENT(32) float lanes[8];
+		TYPEALIGNMENT(32) unsigned laneidxs[8];
+		_mm256_store_ps(lanes, bests);
+		_mm256_store_si256((__m256i *) laneidxs, bestidxs);
+		// Ties go to the lowest index as in the scalar loop
+		for(size_t l=0; l<8; l++)
+			if(lanes[l]<best || (lanes[l]==best && laneidxs[l]<bestidx))
+			{
+				best=lanes[l];
+				bestidx=laneidxs[l];
+			}
+#endif
+		for(; n<myids.size(); n++)
+		{
+			float score=(float) int_logscore(key, myseeds[n])*myinvweights[n];
+			if(score<best)
+			{
+				best=score;
+				bestidx=n;
+			}
+		}
+		return bestidx;
+	}
+public:
+	//! Constructs an empty router
+	WeightedRendezvousHash() { }
+	//! Adds or reweights a bucket. Throws std::invalid_argument if the weight is not positive.
+	void add(unsigned long long id, double weight=1.0)
+	{
+		add(1, &id, &weight);
+	}
+	//! Adds or reweights \em no buckets of weight one, or \em weights if not null. Throws std::invalid_argument if a weight is not positive.
+	void add(size_t no, const unsigned long long *ids, const double *weights=nullptr)
+	{
+		for(size_t n=0; n<no; n++)
+			if(weights && !(weights[n]>0)) throw std::invalid_argument("WeightedRendezvousHash weights must be positive");
+		for(size_t n=0; n<no; n++)
+		{
+			double weight=weights ? weights[n] : 1.0;
+			auto it=std::find(myids.begin(), myids.end(), ids[n]);
+			if(it!=myids.end())
+				myweights[it-myids.begin()]=weight;
+			else
+			{
+				myids.push_back(ids[n]);
+				myweights.push_back(weight);
+			}
+		}
+		int_rebuild();
+	}
+	//! Removes a bucket, returning false if there was none
+	bool remove(unsigned long long id)
+	{
+		auto it=std::find(myids.begin(), myids.end(), id);
+		if(it==myids.end()) return false;
+		myweights.erase(myweights.begin()+(it-myids.begin()));
+		myids.erase(it);
+		int_rebuild();
+		return true;
+	}
+	//! Returns the number of buckets
+	size_t size() const { return myids.size(); }
+	//! Returns the id of bucket \em n
+	unsigned long long id(size_t n) const { return myids[n]; }
+	//! Returns the weight of bucket \em n
+	double weight(size_t n) const { return myweights[n]; }
+	//! Returns the id of the bucket a key routes to. Throws std::logic_error if there are no buckets.
+	template<class K> unsigned long long route(const K &key) const
+	{
+		if(myids.empty()) throw std::logic_error("WeightedRendezvousHash has no buckets");
+		return myids[int_route(Impl::routing_word(key))];
+	}
+	//! Routes \em no keys, writing the ids of their buckets to \em results. Throws std::logic_error if there are no buckets.
+	template<class K> void route(size_t no, const K *keys, unsigned long long *results) const
+	{
+		if(myids.empty()) throw std::logic_error("WeightedRendezvousHash has no buckets");
+		for(size_t n=0; n<no; n++)
+			results[n]=myids[int_route(Impl::routing_word(keys[n]))];
+	}
+};
+
+/*! \class BoundedLoadHashRing
+\brief A consistent hash ring of weighted buckets routing Hash128/Hash256/Int128/Int256 (or their Ref views), optionally with bounded loads.
+
+Each bucket places replicas*weight points on a 64 bit ring and a key routes to the bucket of the first point at or
+after the first 64 bit word of the key, so adding or removing a bucket only moves the keys routing to or from it.
+lookup() routes with a branchless binary search over the last point of each block of eight points, then counts the
+points in the block less than the key with AVX2 compares. Buckets are identified by caller chosen 64 bit ids.
+
+acquire() implements Mirrokni, Thorup and Zadimoghaddam (2018) "Consistent Hashing with Bounded Loads": each bucket
+may hold at most ceil(balance*(load+1)*weight/totalweight) keys, and a key whose bucket is full carries on around the
+ring to the next bucket with room. No bucket then exceeds \em balance times its fair share, while the keys which move
+when buckets are added, removed or fill up stay few. release() returns a key's place in its bucket. Not thread safe.
+
+On an Intel Xeon virtual machine lookup() costs approx. 15ns per key for 10 buckets of 100 replicas, rising to
+300ns for 10,000 buckets as the million points then outgrow the caches.
+*/
+class BoundedLoadHashRing
+{
+	double mybalance;
+	unsigned myreplicas;
+	std::vector<unsigned long long> myids;
+	std::vector<double> myweights;
+	std::vector<unsigned long long> myloads;
+	unsigned long long mytotalload;
+	double mytotalweight;
+	// The points padded with ~0 to a multiple of eight, the bucket of each point, and the last point of each block of eight
+	std::vector<unsigned long long, aligned_allocator<unsigned long long, 32>> mypoints;
+	std::vector<unsigned> mypointbuckets;
+	std::vector<unsigned long long> myblocklast;
+	size_t mynopoints;
+	void int_rebuild()
+	{
+		std::vector<std::pair<unsigned long long, unsigned>> points;
+		mytotalweight=0;
+		for(size_t n=0; n<myids.size(); n++)
+		{
+			size_t replicas=(size_t) ceil(myreplicas*myweights[n]);
+			for(size_t r=0; r<replicas; r++)
+				points.push_back(std::make_pair(Impl::routing_mix64(myids[n]^Impl::routing_mix64(r+1)), (unsigned) n));
+			mytotalweight+=myweights[n];
+		}
+		std::sort(points.begin(), points.end());
+		mynopoints=points.size();
+		size_t padded=(mynopoints+7)&~(size_t) 7;
+		mypoints.assign(padded, ~0ULL);
+		mypointbuckets.assign(padded, 0);
+		for(size_t n=0; n<mynopoints; n++)
+		{
+			mypoints[n]=points[n].first;
+			mypointbuckets[n]=points[n].second;
+		}
+		myblocklast.resize(padded/8);
+		for(size_t n=0; n<myblocklast.size(); n++)
+			myblocklast[n]=mypoints[n*8+7];
+	}
+	// Returns the index of the first point at or after h, wrapping around the ring
+	size_t int_lookup(unsigned long long h) const
+	{
+		// Branchless lower bound of the first block whose last point is at or after h
+		const unsigned long long *base=myblocklast.data();
+		size_t len=myblocklast.size();
+		while(len>1)
+		{
+			size_t half=len/2;
+			base=(base[half]<h) ? base+half : base;
+			len-=half;
+		}
+		size_t block=(size_t)(base-myblocklast.data())+(*base<h);
+		if(block==myblocklast.size()) return 0;
+		const unsigned long long *p=mypoints.data()+block*8;
+#if HAVE_M256
+		const __m256i sign=_mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+		__m256i key=_mm256_xor_si256(_mm256_set1_epi64x((long long) h), sign);
+		__m256i a=_mm256_xor_si256(_mm256_load_si256((const __m256i *) p), sign), b=_mm256_xor_si256(_mm256_load_si256((const __m256i *)(p+4)), sign);
+		unsigned m=(unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, a)));
+		m|=(unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, b)))<<4;
+		size_t idx=block*8+Impl::popcount64(m);
+#else
+		size_t idx=block*8;
+		for(size_t n=0; n<8; n++)
+			idx+=p[n]<h;
+#endif
+		// The padding points of ~0 belong to no bucket
+		return idx<mynopoints ? idx : 0;
+	}
+	unsigned long long int_capacity(size_t bucket) const
+	{
+		return (unsigned long long) ceil(mybalance*(mytotalload+1)*myweights[bucket]/mytotalweight);
+	}
+public:
+	/*! Constructs an empty ring where each bucket of weight one places \em replicas points, and no bucket is loaded
+	beyond \em balance times its fair share by acquire(). Throws std::invalid_argument unless balance>1 and replicas>0.
+	*/
+	explicit BoundedLoadHashRing(double balance=1.25, unsigned replicas=100) : mybalance(balance), myreplicas(replicas), mytotalload(0), mytotalweight(0), mynopoints(0)
+	{
+		if(!(balance>1) || !replicas) throw std::invalid_argument("BoundedLoadHashRing needs a balance above one and at least one replica");
+	}
+	//! Adds or reweights a bucket, which keeps its load. Throws std::invalid_argument if the weight is not positive.
+	void add(unsigned long long id, double weight=1.0)
+	{
+		add(1, &id, &weight);
+	}
+	/*! Adds or reweights \em no buckets of weight one, or \em weights if not null, rebuilding the ring once. Throws
+	std::invalid_argument if a weight is not positive.
+	*/
+	void add(size_t no, const unsigned long long *ids, const double *weights=nullptr)
+	{
+		for(size_t n=0; n<no; n++)
+			if(weights && !(weights[n]>0)) throw std::invalid_argument("BoundedLoadHashRing weights must be positive");
+		for(size_t n=0; n<no; n++)
+		{
+			double weight=weights ? weights[n] : 1.0;
+			auto it=std::find(myids.begin(), myids.end(), ids[n]);
+			if(it!=myids.end())
+				myweights[it-myids.begin()]=weight;
+			else
+			{
+				myids.push_back(ids[n]);
+				myweights.push_back(weight);
+				myloads.push_back(0);
+			}
+		}
+		int_rebuild();
+	}
+	//! Removes a bucket and its load, returning false if there was none
+	bool remove(unsigned long long id)
+	{
+		auto it=std::find(myids.begin(), myids.end(), id);
+		if(it==myids.end()) return false;
+		size_t n=it-myids.begin();
+		mytotalload-=myloads[n];
+		myids.erase(it);
+		myweights.erase(myweights.begin()+n);
+		myloads.erase(myloads.begin()+n);
+		int_rebuild();
+		return true;
+	}
+	//! Returns the number of buckets
+	size_t size() const { return myids.size(); }
+	//! Returns the number of points on the ring
+	size_t points() const { return mynopoints; }
+	//! Returns the id of bucket \em n
+	unsigned long long id(size_t n) const { return myids[n]; }
+	//! Returns the number of keys acquired and not released by bucket \em n
+	unsigned long long load(size_t n) const { return myloads[n]; }
+	//! Returns the number of keys acquired and not released
+	unsigned long long totalLoad() const { return mytotalload; }
+	//! Returns the most keys bucket \em n may hold before acquire() passes it by
+	unsigned long long capacity(size_t n) const { return int_capacity(n); }
+	//! Returns the id of the bucket a key routes to, ignoring loads. Throws std::logic_error if there are no buckets.
+	template<class K> unsigned long long lookup(const K &key) const
+	{
+		if(myids.empty()) throw std::logic_error("BoundedLoadHashRing has no buckets");
+		return myids[mypointbuckets[int_lookup(Impl::routing_word(key))]];
+	}
+	//! Routes \em no keys ignoring loads, writing the ids of their buckets to \em results. Throws std::logic_error if there are no buckets.
+	template<class K> void lookup(size_t no, const K *keys, unsigned long long *results) const
+	{
+		if(myids.empty()) throw std::logic_error("BoundedLoadHashRing has no buckets");
+		for(size_t n=0; n<no; n++)
+			results[n]=myids[mypointbuckets[int_lookup(Impl::routing_word(keys[n]))]];
+	}
+	/*! Routes a key to the first bucket around the ring from it with room, adding it to that bucket's load and returning
+	the bucket's id. Throws std::logic_error if there are no buckets.
+	*/
+	template<class K> unsigned long long acquire(const K &key)
+	{
+		if(myids.empty()) throw std::logic_error("BoundedLoadHashRing has no buckets");
+		size_t idx=int_lookup(Impl::routing_word(key));
+		// As the capacities sum to more than the load some bucket always has room
+		for(;;)
+		{
+			unsigned bucket=mypointbuckets[idx];
+			if(myloads[bucket]<int_capacity(bucket))
+			{
+				myloads[bucket]++;
+				mytotalload++;
+				return myids[bucket];
+			}
+			if(++idx==mynopoints) idx=0;
+		}
+	}
+	//! Acquires \em no keys in order, writing the ids of their buckets to \em results. Throws std::logic_error if there are no buckets.
+	template<class K> void acquire(size_t no, const K *keys, unsigned long long *results)
+	{
+		for(size_t n=0; n<no; n++)
+			results[n]=acquire(keys[n]);
+	}
+	//! Releases a key acquired by the bucket \em id, returning false if there is no such bucket or it has no load
+	bool release(unsigned long long id)
+	{
+		auto it=std::find(myids.begin(), myids.end(), id);
+		if(it==myids.end() || !myloads[it-myids.begin()]) return false;
+		myloads[it-myids.begin()]--;
+		mytotalload--;
+		return true;
+	}
+};
+
+} // namespace
+
+#endif
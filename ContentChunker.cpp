@@ -0,0 +1,252 @@
+/* ContentChunker.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Content defined chunking of streams using a Gear rolling hash, with each
+chunk fingerprinted by Hash256 batch hashing for deduplication.
+*/
+
+#include "ContentChunker.hpp"
+#include "SimdBitset.hpp"
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	// The scan window. Chunks found in one window are hashed while the next is scanned.
+	static const size_t chunker_window=1<<20;
+
+	// Returns the Gear hash of the (up to) 32 bytes before pos, which is all the hash state there is
+	static inline unsigned gear_warm(const unsigned *gear, const unsigned char *data, size_t pos)
+	{
+		unsigned h=0;
+		for(size_t n=pos>32 ? pos-32 : 0; n<pos; n++)
+			h=(h<<1)+gear[data[n]];
+		return h;
+	}
+	// Rolls the Gear hash over [from, to), appending each cut point as (pos<<1)|strong
+	static inline unsigned gear_scan(std::vector<size_t> &cands, const unsigned *gear, const unsigned char *data, unsigned h, size_t from, size_t to, unsigned maskstrong, unsigned maskweak)
+	{
+		for(size_t n=from; n<to; n++)
+		{
+			h=(h<<1)+gear[data[n]];
+			if(!(h & maskweak))
+				cands.push_back(((n+1)<<1)|!(h & maskstrong));
+		}
+		return h;
+	}
+}
+
+const unsigned *ContentChunker::gearTable()
+{
+	// Generated by SplitMix64 with a fixed seed so boundaries are identical across builds and platforms
+	static struct gear_t
+	{
+		unsigned table[256];
+		gear_t()
+		{
+			unsigned long long x=0x6e6564707264ULL;
+			for(size_t n=0; n<256; n++)
+			{
+				unsigned long long z=(x+=0x9e3779b97f4a7c15ULL);
+				z=(z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+				z=(z^(z>>27))*0x94d049bb133111ebULL;
+				table[n]=(unsigned)((z^(z>>31))>>32);
+			}
+		}
+	} gear;
+	return gear.table;
+}
+
+double ContentChunker::Statistics::stddevLength() const
+{
+	if(chunks<2) return 0;
+	double mean=sumLength/chunks, var=sumLengthSquared/chunks-mean*mean;
+	return var>0 ? sqrt(var) : 0;
+}
+
+ContentChunker::ContentChunker(Sink sink, HashType hashtype, size_t minsize, size_t avgsize, size_t maxsize) : mysink(std::move(sink)), myhashtype(hashtype), myminsize(minsize), myavgsize(avgsize), mymaxsize(maxsize), myoffset(0)
+{
+	// The Gear hash depends on the last 32 bytes, so chunks of at least 64 bytes never see state from before their start
+	if(minsize<64 || minsize>avgsize || avgsize>maxsize || avgsize>=((size_t) 1<<30))
+		throw std::invalid_argument("ContentChunker sizes must satisfy 64<=minsize<=avgsize<=maxsize and avgsize<2^30");
+	unsigned bits=0;
+	while(((size_t) 2<<bits)<=avgsize) bits++;
+	myavgsize=(size_t) 1<<bits;
+	// Normalised chunking level 2: two bits stricter before the average, two bits looser after. The top bits of the
+	// hash are used as they depend on the most bytes, and every strong cut point is also a weak one.
+	unsigned strongbits=bits+2>31 ? 31 : bits+2, weakbits=bits>2 ? bits-2 : 1;
+	mymaskstrong=~0U<<(32-strongbits);
+	mymaskweak=~0U<<(32-weakbits);
+	resetStatistics();
+}
+
+void ContentChunker::resetStatistics()
+{
+	memset(&mystats, 0, sizeof(mystats));
+	mystats.minLength=(size_t) -1;
+}
+
+void ContentChunker::int_scan(std::vector<size_t> &cands, const char *_data, size_t from, size_t to) const
+{
+	const unsigned *gear=gearTable();
+	const unsigned char *data=(const unsigned char *) _data;
+#if HAVE_M256
+	// Eight lanes each roll over their own segment, so gathers replace the serial dependency on the previous byte
+	size_t seg=(to-from)/8;
+	if(seg>=64)
+	{
+		std::vector<size_t> lanecands[8];
+		TYPEALIGNMENT(32) unsigned hs[8];
+		TYPEALIGNMENT(32) int offs[8];
+		for(size_t l=0; l<8; l++)
+		{
+			hs[l]=Impl::gear_warm(gear, data, from+l*seg);
+			offs[l]=(int)(l*seg);
+		}
+		const unsigned char *base=data+from;
+		const __m256i ff=_mm256_set1_epi32(0xff), four=_mm256_set1_epi32(4), zero=_mm256_setzero_si256();
+		const __m256i maskweak=_mm256_set1_epi32((int) mymaskweak);
+		__m256i h=_mm256_load_si256((const __m256i *) hs), off=_mm256_load_si256((const __m256i *) offs);
+		// Each lane gathers four bytes at a time, and any remaining bytes at the end of each lane are done scalar
+		size_t step=0;
+		for(; step+4<=seg; step+=4)
+		{
+			__m256i w=_mm256_i32gather_epi32((const int *) base, off, 1);
+			off=_mm256_add_epi32(off, four);
+			for(size_t k=0; k<4; k++)
+			{
+				__m256i g=_mm256_i32gather_epi32((const int *) gear, _mm256_and_si256(w, ff), 4);
+				w=_mm256_srli_epi32(w, 8);
+				h=_mm256_add_epi32(_mm256_add_epi32(h, h), g);
+				int m=_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, maskweak), zero)));
+				if(m)
+				{
+					_mm256_store_si256((__m256i *) hs, h);
+					do
+					{
+						size_t l=Impl::bitset_lowest_bit((unsigned long long) m);
+						lanecands[l].push_back(((from+l*seg+step+k+1)<<1)|!(hs[l] & mymaskstrong));
+						m&=m-1;
+					} while(m);
+				}
+			}
+		}
+		_mm256_store_si256((__m256i *) hs, h);
+		for(size_t l=0; l<8; l++)
+		{
+			Impl::gear_scan(lanecands[l], gear, data, hs[l], from+l*seg+step, from+(l+1)*seg, mymaskstrong, mymaskweak);
+			cands.insert(cands.end(), lanecands[l].begin(), lanecands[l].end());
+		}
+		from+=8*seg;
+	}
+#endif
+	Impl::gear_scan(cands, gear, data, Impl::gear_warm(gear, data, from), from, to, mymaskstrong, mymaskweak);
+}
+
+size_t ContentChunker::process(const char *data, size_t length, bool final)
+{
+	typedef std::chrono::duration<double, std::ratio<1>> secs_type;
+	auto begin=std::chrono::high_resolution_clock::now();
+	std::vector<size_t> cands, nextcands;
+	std::vector<Chunk> chunks;
+	std::vector<const char *> datas;
+	std::vector<size_t> lengths;
+	size_t candidx=0, start=0, scanned=std::min(length, Impl::chunker_window);
+	{
+		auto scanbegin=std::chrono::high_resolution_clock::now();
+		int_scan(cands, data, 0, scanned);
+		mystats.scanSecs+=std::chrono::duration_cast<secs_type>(std::chrono::high_resolution_clock::now()-scanbegin).count();
+	}
+	for(;;)
+	{
+		// Select as many chunks as the scanned region determines
+		chunks.clear();
+		bool atend=final && scanned==length;
+		while(start<scanned)
+		{
+			size_t lo=start+myminsize, mid=start+myavgsize, hi=start+mymaxsize, cut=0;
+			while(candidx<cands.size() && (cands[candidx]>>1)<lo) candidx++;
+			size_t n=candidx;
+			for(; n<cands.size() && (cands[n]>>1)<=mid; n++)
+				if(cands[n] & 1) { cut=cands[n]>>1; break; }
+			if(!cut && scanned>=mid)
+			{
+				if(n<cands.size() && (cands[n]>>1)<=hi)
+					cut=cands[n]>>1;
+				else if(scanned>=hi)
+					cut=hi;
+			}
+			if(!cut)
+			{
+				if(!atend) break;
+				cut=scanned;
+			}
+			Chunk c={ myoffset+start, data+start, cut-start };
+			chunks.push_back(c);
+			start=cut;
+		}
+		size_t next=std::min(length, scanned+Impl::chunker_window);
+		if(chunks.empty() && next==scanned) break;
+		// Hash this batch while scanning the next window
+		std::vector<Hash256> hashes(chunks.size());
+		nextcands.clear();
+#pragma omp parallel sections num_threads(2) if(!chunks.empty() && next>scanned && myhashtype!=HashType::None)
+		{
+#pragma omp section
+			if(!chunks.empty() && myhashtype!=HashType::None)
+			{
+				auto hashbegin=std::chrono::high_resolution_clock::now();
+				datas.resize(chunks.size());
+				lengths.resize(chunks.size());
+				for(size_t n=0; n<chunks.size(); n++)
+				{
+					datas[n]=chunks[n].data;
+					lengths[n]=chunks[n].length;
+				}
+				if(HashType::SHA256==myhashtype)
+					Hash256::BatchAddSHA256To(chunks.size(), hashes.data(), datas.data(), lengths.data());
+				else
+					Hash256::BatchAddFastHashTo(chunks.size(), hashes.data(), datas.data(), lengths.data());
+				mystats.hashSecs+=std::chrono::duration_cast<secs_type>(std::chrono::high_resolution_clock::now()-hashbegin).count();
+			}
+#pragma omp section
+			if(next>scanned)
+			{
+				auto scanbegin=std::chrono::high_resolution_clock::now();
+				int_scan(nextcands, data, scanned, next);
+				mystats.scanSecs+=std::chrono::duration_cast<secs_type>(std::chrono::high_resolution_clock::now()-scanbegin).count();
+			}
+		}
+		if(!chunks.empty())
+		{
+			if(HashType::None==myhashtype)
+				memset((void *) hashes.data(), 0, hashes.size()*sizeof(Hash256));
+			for(auto &c : chunks)
+			{
+				mystats.chunks++;
+				mystats.bytes+=c.length;
+				if(c.length<mystats.minLength) mystats.minLength=c.length;
+				if(c.length>mystats.maxLength) mystats.maxLength=c.length;
+				mystats.sumLength+=(double) c.length;
+				mystats.sumLengthSquared+=(double) c.length*(double) c.length;
+			}
+			mysink(chunks.size(), chunks.data(), hashes.data());
+		}
+		// Drop consumed candidates and append the new window's
+		cands.erase(cands.begin(), cands.begin()+candidx);
+		candidx=0;
+		cands.insert(cands.end(), nextcands.begin(), nextcands.end());
+		scanned=next;
+	}
+	myoffset=final ? 0 : myoffset+start;
+	mystats.totalSecs+=std::chrono::duration_cast<secs_type>(std::chrono::high_resolution_clock::now()-begin).count();
+	return start;
+}
+
+} // namespace
@@ -0,0 +1,476 @@
+/* DigestFilters.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Blocked Bloom filter and cuckoo filter for digests. As digests are already
+uniformly random, bucket indices and bit positions are taken directly from the
+digest words rather than rehashing them.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_DIGESTFILTERS_H
+#define NIALLSCPP11UTILITIES_DIGESTFILTERS_H
+
+/*! \file DigestFilters.hpp
+\brief Provides the DigestBloomFilter and DigestCuckooFilter approximate membership filters
+*/
+
+#include "Int128_256.hpp"
+#include <stdexcept>
+#include <vector>
+#if HAVE_M128
+#include <xmmintrin.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	/*! \struct DigestFilterHeader
+	\brief The first 64 bytes of a serialised filter, in native byte order.
+	*/
+	struct DigestFilterHeader
+	{
+		char magic[8];					//!< "NEDDGFLT"
+		unsigned int version;			//!< Currently 1
+		unsigned int kind;				//!< 1 for Bloom, 2 for cuckoo
+		unsigned long long blocks;		//!< Number of 256 bit blocks following the header
+		unsigned long long items;		//!< Number of items inserted
+		unsigned long long victimindex;	//!< Cuckoo filter bucket of the evicted fingerprint
+		unsigned int victimfp;			//!< Cuckoo filter evicted fingerprint, zero if none
+		unsigned int reserved1;
+		unsigned long long reserved2[2];
+	};
+
+	//! Returns the first two 64 bit words of a digest of at least 128 bits
+	template<class K> inline void digest_filter_words(const K &k, unsigned long long &w0, unsigned long long &w1)
+	{
+		unsigned long long w[2];
+		memcpy(w, k.asBytes(), sizeof(w));
+		w0=w[0];
+		w1=w[1];
+	}
+	inline void digest_filter_prefetch(const void *p)
+	{
+#if HAVE_M128
+		_mm_prefetch((const char *) p, _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(p);
+#endif
+	}
+
+	/*! \class DigestFilterStorage
+	\brief The storage shared by the digest filters, being a header followed by 256 bit blocks.
+
+	The storage is either owned, or is a view of a buffer such as a mapped file holding a serialised filter.
+	*/
+	class DigestFilterStorage
+	{
+		std::vector<Int256, aligned_allocator<Int256, 32>> _owned;
+		bool _readonly;
+		void int_init(unsigned int kind, size_t blocks)
+		{
+			_owned.resize(2+blocks);
+			_header=(DigestFilterHeader *) _owned.data();
+			_blocks=_owned.data()+2;
+			memcpy(_header->magic, "NEDDGFLT", 8);
+			_header->version=1;
+			_header->kind=kind;
+			_header->blocks=blocks;
+		}
+		void int_view(unsigned int kind, const char *buffer, size_t length)
+		{
+			if(((size_t) buffer) & 31) throw std::invalid_argument("Filter buffer must be aligned to 32 bytes");
+			if(length<sizeof(DigestFilterHeader)) throw std::invalid_argument("Filter buffer too small");
+			_header=(DigestFilterHeader *) buffer;
+			if(memcmp(_header->magic, "NEDDGFLT", 8) || _header->version!=1 || _header->kind!=kind)
+				throw std::invalid_argument("Filter buffer does not contain a filter of this kind");
+			if(length<sizeof(DigestFilterHeader)+_header->blocks*sizeof(Int256)) throw std::invalid_argument("Filter buffer too small");
+			_blocks=(Int256 *)(buffer+sizeof(DigestFilterHeader));
+		}
+	protected:
+		DigestFilterHeader *_header;
+		Int256 *_blocks;
+		DigestFilterStorage(unsigned int kind, size_t blocks) : _readonly(false) { int_init(kind, blocks); }
+		DigestFilterStorage(unsigned int kind, char *buffer, size_t length) : _readonly(false) { int_view(kind, buffer, length); }
+		DigestFilterStorage(unsigned int kind, const char *buffer, size_t length) : _readonly(true) { int_view(kind, buffer, length); }
+		DigestFilterStorage(const DigestFilterStorage &o) : _owned(o._owned), _readonly(o._readonly), _header(o._header), _blocks(o._blocks)
+		{
+			if(!_owned.empty())
+			{
+				_header=(DigestFilterHeader *) _owned.data();
+				_blocks=_owned.data()+2;
+			}
+		}
+		DigestFilterStorage &operator=(const DigestFilterStorage &o)
+		{
+			_owned=o._owned;
+			_readonly=o._readonly;
+			_header=o._header;
+			_blocks=o._blocks;
+			if(!_owned.empty())
+			{
+				_header=(DigestFilterHeader *) _owned.data();
+				_blocks=_owned.data()+2;
+			}
+			return *this;
+		}
+		void int_writable() const
+		{
+			if(_readonly) throw std::logic_error("Filter is a read only view");
+		}
+		void int_compatible(const DigestFilterStorage &o) const
+		{
+			if(_header->kind!=o._header->kind || _header->blocks!=o._header->blocks)
+				throw std::invalid_argument("Filters must be of the same kind and size to be merged");
+		}
+	public:
+		//! Returns the serialised form of the filter, which may be written to disc and later mapped back in
+		const char *data() const { return (const char *) _header; }
+		//! Returns the size of the serialised form of the filter
+		size_t dataSize() const { return sizeof(DigestFilterHeader)+(size_t) _header->blocks*sizeof(Int256); }
+		//! True if the filter is a view of an external buffer
+		bool isView() const { return _owned.empty(); }
+		//! Returns the number of items inserted
+		size_t size() const { return (size_t) _header->items; }
+		//! Returns the bytes used by the filter table
+		size_t memoryUsage() const { return (size_t) _header->blocks*sizeof(Int256); }
+	};
+}
+
+/*! \class DigestBloomFilter
+\brief A register blocked Bloom filter of Hash128/Hash256/Int128/Int256 (or their Ref views) which never rehashes.
+
+Each item sets eight bits, one in each 32 bit word of a single 256 bit block, so a query touches one cache line
+and with AVX2 is a single vpsllvd and vptest. The block is chosen from the first 64 bit word of the digest and
+the eight bit positions from the second, so keys must be uniformly random and at least 128 bits. At 16 bits per
+item the false positive rate is approx. 0.1%, and at 8 bits per item approx. 3%.
+
+Filters of the same size may be merged. data() and dataSize() give a serialised form which can be written out
+and then mapped back in via the buffer constructors without copying.
+*/
+class DigestBloomFilter : public Impl::DigestFilterStorage
+{
+	const Int256 &int_block(unsigned long long w0) const { return _blocks[(size_t)(((w0>>32)*_header->blocks)>>32)]; }
+#if HAVE_M256
+	static __m256i int_mask(unsigned long long w1)
+	{
+		// Four five bit positions from each half of w1
+		__m256i v=_mm256_set_epi32((int)(w1>>32), (int)(w1>>32), (int)(w1>>32), (int)(w1>>32), (int) w1, (int) w1, (int) w1, (int) w1);
+		__m256i idx=_mm256_and_si256(_mm256_srlv_epi32(v, _mm256_setr_epi32(0, 5, 10, 15, 0, 5, 10, 15)), _mm256_set1_epi32(31));
+		return _mm256_sllv_epi32(_mm256_set1_epi32(1), idx);
+	}
+#endif
+	static unsigned int int_maskword(unsigned long long w1, int n)
+	{
+		return 1U<<(((unsigned int)(w1>>(32*(n>>2)))>>(5*(n&3)))&31);
+	}
+	static bool int_test(const Int256 &block, unsigned long long w1)
+	{
+#if HAVE_M256
+		return 0!=_mm256_testc_si256(_mm256_load_si256((const __m256i *) block.asBytes()), int_mask(w1));
+#else
+		const unsigned int *words=block.asInts();
+		for(int n=0; n<8; n++)
+			if(!(words[n] & int_maskword(w1, n))) return false;
+		return true;
+#endif
+	}
+public:
+	enum { kind=1 };
+	//! Constructs a filter sized for \em items at \em bitsperitem bits each
+	explicit DigestBloomFilter(size_t items, double bitsperitem=16) : Impl::DigestFilterStorage(kind, (size_t)(items*bitsperitem/256)+1) { }
+	//! Constructs a writable view of a serialised filter e.g. in a read/write mapped file
+	DigestBloomFilter(char *buffer, size_t length) : Impl::DigestFilterStorage(kind, buffer, length) { }
+	//! Constructs a read only view of a serialised filter e.g. in a read only mapped file
+	DigestBloomFilter(const char *buffer, size_t length) : Impl::DigestFilterStorage(kind, buffer, length) { }
+
+	//! Inserts a digest
+	template<class K> void insert(const K &k)
+	{
+		int_writable();
+		unsigned long long w0, w1;
+		Impl::digest_filter_words(k, w0, w1);
+		Int256 &block=const_cast<Int256 &>(int_block(w0));
+#if HAVE_M256
+		__m256i *b=(__m256i *) block.asBytes();
+		_mm256_store_si256(b, _mm256_or_si256(_mm256_load_si256(b), int_mask(w1)));
+#else
+		unsigned int *words=const_cast<unsigned int *>(block.asInts());
+		for(int n=0; n<8; n++)
+			words[n]|=int_maskword(w1, n);
+#endif
+		_header->items++;
+	}
+	//! True if the digest may have been inserted, false if it definitely was not
+	template<class K> bool contains(const K &k) const
+	{
+		unsigned long long w0, w1;
+		Impl::digest_filter_words(k, w0, w1);
+		return int_test(int_block(w0), w1);
+	}
+	/*! \brief Tests \em no digests, setting \em results and returning how many may have been inserted.
+
+	Blocks are prefetched a batch ahead so the cache misses of large filters overlap.
+	*/
+	template<class K> size_t batchContains(size_t no, const K *keys, bool *results) const
+	{
+		static const size_t batch=16;
+		const Int256 *blocks[batch];
+		unsigned long long w1s[batch];
+		size_t ret=0;
+		for(size_t n=0; n<no; n+=batch)
+		{
+			size_t thisno=(no-n<batch) ? no-n : batch;
+			for(size_t i=0; i<thisno; i++)
+			{
+				unsigned long long w0;
+				Impl::digest_filter_words(keys[n+i], w0, w1s[i]);
+				blocks[i]=&int_block(w0);
+				Impl::digest_filter_prefetch(blocks[i]);
+			}
+			for(size_t i=0; i<thisno; i++)
+				ret+=(results[n+i]=int_test(*blocks[i], w1s[i]));
+		}
+		return ret;
+	}
+	//! Adds all the items of another filter of the same size into this one
+	void merge(const DigestBloomFilter &o)
+	{
+		int_writable();
+		int_compatible(o);
+		for(size_t n=0; n<_header->blocks; n++)
+			_blocks[n]|=o._blocks[n];
+		_header->items+=o._header->items;
+	}
+	//! Clears the filter
+	void clear()
+	{
+		int_writable();
+		memset((void *) _blocks, 0, (size_t) _header->blocks*sizeof(Int256));
+		_header->items=0;
+	}
+};
+
+/*! \class DigestCuckooFilter
+\brief A cuckoo filter of Hash128/Hash256/Int128/Int256 (or their Ref views) which never rehashes, and which supports erase.
+
+Implements Fan, Andersen, Kaminsky and Mitzenmacher (2014) "Cuckoo Filter: Practically Better Than Bloom" with
+buckets of four 16 bit fingerprints, so each bucket is one 64 bit word and both candidate buckets are tested with a
+single SSE2 compare. The first bucket comes from the first 64 bit word of the digest and the fingerprint from the
+second, and the alternate bucket is computed so that the table need not be a power of two in size. The false
+positive rate is approx. 0.012% at up to 95% load, using 16.8 bits per item.
+
+Filters of the same size may be merged. data() and dataSize() give a serialised form which can be written out
+and then mapped back in via the buffer constructors without copying.
+*/
+class DigestCuckooFilter : public Impl::DigestFilterStorage
+{
+	unsigned long long _seed;
+	unsigned long long *int_buckets() const { return const_cast<unsigned long long *>(_blocks[0].asLongLongs()); }
+	size_t int_buckets_count() const { return (size_t)(_header->blocks*4); }
+	// The alternate bucket is (h(fp)-idx) mod buckets which is its own inverse for any number of buckets
+	size_t int_alt(size_t idx, unsigned int fp) const
+	{
+		size_t buckets=int_buckets_count(), h=(size_t)(((unsigned long long)(fp*0x5bd1e995U)*buckets)>>32);
+		return h>=idx ? h-idx : h+buckets-idx;
+	}
+	static void int_fingerprint(unsigned long long w0, unsigned long long w1, size_t buckets, size_t &idx, unsigned int &fp)
+	{
+		idx=(size_t)(((w0>>32)*buckets)>>32);
+		fp=(unsigned int)(w1 & 0xffff);
+		if(!fp) fp=1;
+	}
+	static bool int_bucketHas(unsigned long long bucket, unsigned int fp)
+	{
+		unsigned long long x=bucket^(fp*0x0001000100010001ULL);
+		return 0!=((x-0x0001000100010001ULL) & ~x & 0x8000800080008000ULL);
+	}
+	bool int_test(size_t i1, unsigned int fp) const
+	{
+		size_t i2=int_alt(i1, fp);
+		const unsigned long long *buckets=int_buckets();
+#if HAVE_M128
+		__m128i b=_mm_set_epi64x((long long) buckets[i2], (long long) buckets[i1]);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(b, _mm_set1_epi16((short) fp)))) return true;
+#else
+		if(int_bucketHas(buckets[i1], fp) || int_bucketHas(buckets[i2], fp)) return true;
+#endif
+		return _header->victimfp==fp && (_header->victimindex==i1 || _header->victimindex==i2);
+	}
+	// Tries to put fp into an empty slot of bucket idx
+	bool int_put(size_t idx, unsigned int fp)
+	{
+		unsigned long long &bucket=int_buckets()[idx];
+		for(int n=0; n<64; n+=16)
+			if(!((bucket>>n) & 0xffff))
+			{
+				bucket|=(unsigned long long) fp<<n;
+				return true;
+			}
+		return false;
+	}
+	bool int_remove(size_t idx, unsigned int fp)
+	{
+		unsigned long long &bucket=int_buckets()[idx];
+		for(int n=0; n<64; n+=16)
+			if(((bucket>>n) & 0xffff)==fp)
+			{
+				bucket&=~(0xffffULL<<n);
+				return true;
+			}
+		return false;
+	}
+	bool int_insert(size_t idx, unsigned int fp)
+	{
+		if(_header->victimfp) return false;
+		if(int_put(idx, fp) || int_put(int_alt(idx, fp), fp))
+		{
+			_header->items++;
+			return true;
+		}
+		// Evict a random fingerprint to its alternate bucket until one finds space
+		for(int kicks=0; kicks<500; kicks++)
+		{
+			_seed^=_seed<<13; _seed^=_seed>>7; _seed^=_seed<<17;
+			int lane=16*(int)(_seed & 3);
+			unsigned long long &bucket=int_buckets()[idx];
+			unsigned int evicted=(unsigned int)((bucket>>lane) & 0xffff);
+			bucket=(bucket & ~(0xffffULL<<lane))|((unsigned long long) fp<<lane);
+			fp=evicted;
+			idx=int_alt(idx, fp);
+			if(int_put(idx, fp))
+			{
+				_header->items++;
+				return true;
+			}
+		}
+		// The filter is full, so keep the last evicted fingerprint aside. Nothing more can be inserted.
+		_header->victimindex=idx;
+		_header->victimfp=fp;
+		_header->items++;
+		return true;
+	}
+	static size_t int_blocks_for(size_t items)
+	{
+		// Four buckets of four fingerprints per block
+		return (size_t)(items/(16*0.95))+1;
+	}
+public:
+	enum { kind=2 };
+	//! Constructs a filter sized for \em items at up to 95% load
+	explicit DigestCuckooFilter(size_t items) : Impl::DigestFilterStorage(kind, int_blocks_for(items)), _seed(0x9E3779B97F4A7C15ULL) { }
+	//! Constructs a writable view of a serialised filter e.g. in a read/write mapped file
+	DigestCuckooFilter(char *buffer, size_t length) : Impl::DigestFilterStorage(kind, buffer, length), _seed(0x9E3779B97F4A7C15ULL) { }
+	//! Constructs a read only view of a serialised filter e.g. in a read only mapped file
+	DigestCuckooFilter(const char *buffer, size_t length) : Impl::DigestFilterStorage(kind, buffer, length), _seed(0x9E3779B97F4A7C15ULL) { }
+
+	//! Inserts a digest, returning false if the filter is full
+	template<class K> bool insert(const K &k)
+	{
+		int_writable();
+		unsigned long long w0, w1;
+		Impl::digest_filter_words(k, w0, w1);
+		size_t idx;
+		unsigned int fp;
+		int_fingerprint(w0, w1, int_buckets_count(), idx, fp);
+		return int_insert(idx, fp);
+	}
+	//! Erases a previously inserted digest, returning false if it was not found. Erasing a digest never inserted may erase another.
+	template<class K> bool erase(const K &k)
+	{
+		int_writable();
+		unsigned long long w0, w1;
+		Impl::digest_filter_words(k, w0, w1);
+		size_t i1;
+		unsigned int fp;
+		int_fingerprint(w0, w1, int_buckets_count(), i1, fp);
+		size_t i2=int_alt(i1, fp);
+		if(int_remove(i1, fp) || int_remove(i2, fp))
+		{
+			_header->items--;
+			// Try to put the victim back now there may be space
+			if(_header->victimfp)
+			{
+				unsigned int vfp=_header->victimfp;
+				size_t vidx=(size_t) _header->victimindex;
+				_header->victimfp=0;
+				_header->items--;
+				int_insert(vidx, vfp);
+			}
+			return true;
+		}
+		if(_header->victimfp==fp && (_header->victimindex==i1 || _header->victimindex==i2))
+		{
+			_header->victimfp=0;
+			_header->items--;
+			return true;
+		}
+		return false;
+	}
+	//! True if the digest may have been inserted, false if it definitely was not
+	template<class K> bool contains(const K &k) const
+	{
+		unsigned long long w0, w1;
+		Impl::digest_filter_words(k, w0, w1);
+		size_t idx;
+		unsigned int fp;
+		int_fingerprint(w0, w1, int_buckets_count(), idx, fp);
+		return int_test(idx, fp);
+	}
+	/*! \brief Tests \em no digests, setting \em results and returning how many may have been inserted.
+
+	Both candidate buckets are prefetched a batch ahead so the cache misses of large filters overlap.
+	*/
+	template<class K> size_t batchContains(size_t no, const K *keys, bool *results) const
+	{
+		static const size_t batch=16;
+		size_t idxs[batch];
+		unsigned int fps[batch];
+		const unsigned long long *buckets=int_buckets();
+		size_t ret=0;
+		for(size_t n=0; n<no; n+=batch)
+		{
+			size_t thisno=(no-n<batch) ? no-n : batch;
+			for(size_t i=0; i<thisno; i++)
+			{
+				unsigned long long w0, w1;
+				Impl::digest_filter_words(keys[n+i], w0, w1);
+				int_fingerprint(w0, w1, int_buckets_count(), idxs[i], fps[i]);
+				Impl::digest_filter_prefetch(buckets+idxs[i]);
+				Impl::digest_filter_prefetch(buckets+int_alt(idxs[i], fps[i]));
+			}
+			for(size_t i=0; i<thisno; i++)
+				ret+=(results[n+i]=int_test(idxs[i], fps[i]));
+		}
+		return ret;
+	}
+	/*! \brief Inserts all the items of another filter of the same size into this one.
+
+	Returns false if this filter became full, in which case some items may not have been merged.
+	*/
+	bool merge(const DigestCuckooFilter &o)
+	{
+		int_writable();
+		int_compatible(o);
+		const unsigned long long *obuckets=o.int_buckets();
+		for(size_t idx=0; idx<int_buckets_count(); idx++)
+			for(int n=0; n<64; n+=16)
+			{
+				unsigned int fp=(unsigned int)((obuckets[idx]>>n) & 0xffff);
+				if(fp && !int_insert(idx, fp)) return false;
+			}
+		if(o._header->victimfp && !int_insert((size_t) o._header->victimindex, o._header->victimfp)) return false;
+		return true;
+	}
+	//! Clears the filter
+	void clear()
+	{
+		int_writable();
+		memset((void *) _blocks, 0, (size_t) _header->blocks*sizeof(Int256));
+		_header->items=0;
+		_header->victimfp=0;
+	}
+};
+
+} // namespace
+
+#endif
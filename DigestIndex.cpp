@@ -0,0 +1,317 @@
+/* DigestIndex.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+A sorted table of 256 bit digests persisted to a file, which is memory mapped
+and searched by interpolation so lookups touch O(1) pages without loading it.
+*/
+
+#include "DigestIndex.hpp"
+#include "ErrorHandling.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <stdio.h>
+#include <errno.h>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if HAVE_M128
+#include <xmmintrin.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	static const size_t digest_index_page=4096;
+
+	// Returns the first eight bytes of a digest as a big endian integer, so integer order is memcmp() order
+	static inline unsigned long long digest_index_prefix(const void *p)
+	{
+		unsigned long long v;
+		memcpy(&v, p, sizeof(v));
+#ifdef _MSC_VER
+		return _byteswap_uint64(v);
+#else
+		return __builtin_bswap64(v);
+#endif
+	}
+	// Returns the top 64 bits of a*b
+	static inline unsigned long long digest_index_mulhi(unsigned long long a, unsigned long long b)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return __umulh(a, b);
+#elif defined(__SIZEOF_INT128__)
+		return (unsigned long long)(((unsigned __int128) a*b)>>64);
+#else
+		unsigned long long al=(unsigned) a, ah=a>>32, bl=(unsigned) b, bh=b>>32;
+		unsigned long long m=(al*bl>>32)+(unsigned)(ah*bl)+(unsigned)(al*bh);
+		return ah*bh+(ah*bl>>32)+(al*bh>>32)+(m>>32);
+#endif
+	}
+	static inline void digest_index_prefetch(const void *p)
+	{
+#if HAVE_M128
+		_mm_prefetch((const char *) p, _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(p);
+#endif
+	}
+	// Returns how many of the no<=8 digests at table have a prefix less than k
+	static inline size_t digest_index_count_less(const Int256 *table, size_t no, unsigned long long k)
+	{
+#if HAVE_M256
+		if(8==no)
+		{
+			// Gather the first eight bytes of each digest, byte swap them and do an unsigned compare by flipping the sign bits
+			const __m256i offsets=_mm256_set_epi64x(96, 64, 32, 0);
+			const __m256i bswap=_mm256_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+			const __m256i sign=_mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+			__m256i key=_mm256_xor_si256(_mm256_set1_epi64x((long long) k), sign);
+			__m256i a=_mm256_i64gather_epi64((const long long *) table, offsets, 1);
+			__m256i b=_mm256_i64gather_epi64((const long long *)(table+4), offsets, 1);
+			a=_mm256_xor_si256(_mm256_shuffle_epi8(a, bswap), sign);
+			b=_mm256_xor_si256(_mm256_shuffle_epi8(b, bswap), sign);
+			unsigned m=(unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, a)));
+			m|=(unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(key, b)))<<4;
+			return (size_t) Impl::popcount64(m);
+		}
+#endif
+		size_t ret=0;
+		for(size_t n=0; n<no; n++)
+			ret+=digest_index_prefix(table+n)<k;
+		return ret;
+	}
+}
+
+size_t DigestIndexWriter::write(const std::filesystem::path &path, unsigned fanoutbits)
+{
+	typedef std::vector<Int256, aligned_allocator<Int256, 32>> digests_type;
+	size_t items=mydigests.size();
+	if(!fanoutbits)
+	{
+		fanoutbits=1;
+		while(fanoutbits<32 && (items>>fanoutbits)>256) fanoutbits++;
+	}
+	if(fanoutbits>32) throw std::invalid_argument("fanoutbits cannot exceed 32");
+	const size_t buckets=(size_t) 1<<fanoutbits;
+	const unsigned shift=64-fanoutbits;
+	// Bucket sort by the top bits
+	std::vector<unsigned long long> fanout(buckets+1, 0);
+	for(size_t n=0; n<items; n++)
+		fanout[(size_t)(Impl::digest_index_prefix(mydigests.data()+n)>>shift)+1]++;
+	for(size_t b=0; b<buckets; b++)
+		fanout[b+1]+=fanout[b];
+	digests_type sorted(items);
+	{
+		std::vector<unsigned long long> pos(fanout.begin(), fanout.end()-1);
+		for(size_t n=0; n<items; n++)
+			sorted[(size_t) pos[(size_t)(Impl::digest_index_prefix(mydigests.data()+n)>>shift)]++]=mydigests[n];
+	}
+	digests_type().swap(mydigests);
+	// Sort and deduplicate each bucket in parallel
+	std::vector<unsigned long long> uniques(buckets);
+#pragma omp parallel for schedule(dynamic, 64)
+	for(ptrdiff_t b=0; b<(ptrdiff_t) buckets; b++)
+	{
+		Int256 *begin=sorted.data()+fanout[b], *end=sorted.data()+fanout[b+1];
+		std::sort(begin, end, [](const Int256 &a, const Int256 &b) { return memcmp(&a, &b, sizeof(Int256))<0; });
+		uniques[b]=std::unique(begin, end)-begin;
+	}
+	// Compact the buckets down over the duplicates removed
+	size_t out=0;
+	for(size_t b=0; b<buckets; b++)
+	{
+		size_t in=(size_t) fanout[b];
+		fanout[b]=out;
+		if(out!=in)
+			memmove((void *)(sorted.data()+out), sorted.data()+in, (size_t) uniques[b]*sizeof(Int256));
+		out+=(size_t) uniques[b];
+	}
+	fanout[buckets]=out;
+
+	Impl::DigestIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "NEDDGIDX", 8);
+	header.version=1;
+	header.fanoutbits=fanoutbits;
+	header.items=out;
+	header.fanoutoffset=sizeof(header);
+	header.tableoffset=(sizeof(header)+fanout.size()*sizeof(unsigned long long)+Impl::digest_index_page-1) & ~(unsigned long long)(Impl::digest_index_page-1);
+	FILE *fh=fopen(path.string().c_str(), "wb");
+	if(!fh) ERRGOSFN(errno, path);
+	static const char zeros[Impl::digest_index_page]={0};
+	size_t padding=(size_t)(header.tableoffset-header.fanoutoffset-fanout.size()*sizeof(unsigned long long));
+	bool ok=fwrite(&header, sizeof(header), 1, fh)==1
+		&& fwrite(fanout.data(), sizeof(unsigned long long), fanout.size(), fh)==fanout.size()
+		&& fwrite(zeros, 1, padding, fh)==padding
+		&& (!out || fwrite(sorted.data(), sizeof(Int256), out, fh)==out);
+	int errcode=errno;
+	if(fclose(fh) && ok) { ok=false; errcode=errno; }
+	if(!ok) ERRGOSFN(errcode, path);
+	return out;
+}
+
+void DigestIndex::int_view(const char *buffer, size_t length)
+{
+	if(((size_t) buffer) & 31) throw std::invalid_argument("Digest index buffer must be aligned to 32 bytes");
+	if(length<sizeof(Impl::DigestIndexHeader)) throw std::invalid_argument("Digest index buffer too small");
+	myheader=(const Impl::DigestIndexHeader *) buffer;
+	if(memcmp(myheader->magic, "NEDDGIDX", 8) || myheader->version!=1 || !myheader->fanoutbits || myheader->fanoutbits>32 || (myheader->tableoffset & 31))
+		throw std::invalid_argument("Buffer does not contain a digest index");
+	myfanoutbits=myheader->fanoutbits;
+	if(myheader->fanoutoffset+(((unsigned long long) 1<<myfanoutbits)+1)*sizeof(unsigned long long)>myheader->tableoffset
+		|| length<myheader->tableoffset+myheader->items*sizeof(Int256))
+		throw std::invalid_argument("Digest index buffer too small");
+	myfanout=(const unsigned long long *)(buffer+myheader->fanoutoffset);
+	mytable=(const Int256 *)(buffer+myheader->tableoffset);
+}
+
+void DigestIndex::int_unmap()
+{
+	if(mymapping)
+	{
+#ifdef WIN32
+		UnmapViewOfFile(mymapping);
+#else
+		munmap(mymapping, mymaplength);
+#endif
+		mymapping=nullptr;
+	}
+}
+
+DigestIndex::DigestIndex(const std::filesystem::path &path) : mymapping(nullptr), mymaplength(0)
+{
+#ifdef WIN32
+	HANDLE fh=CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if(INVALID_HANDLE_VALUE==fh) ERRGWINFN(GetLastError(), path);
+	LARGE_INTEGER size;
+	HANDLE mh=NULL;
+	if(GetFileSizeEx(fh, &size) && size.QuadPart)
+		mh=CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	DWORD errcode=GetLastError();
+	CloseHandle(fh);
+	if(!mh) ERRGWINFN(errcode, path);
+	mymapping=MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	errcode=GetLastError();
+	CloseHandle(mh);
+	if(!mymapping) ERRGWINFN(errcode, path);
+	mymaplength=(size_t) size.QuadPart;
+#else
+	int fd;
+	ERRHOSFN(fd=open(path.c_str(), O_RDONLY), path);
+	struct stat s;
+	if(fstat(fd, &s)<0) { int errcode=errno; ::close(fd); ERRGOSFN(errcode, path); }
+	if(s.st_size<(off_t) sizeof(Impl::DigestIndexHeader)) { ::close(fd); throw std::invalid_argument("File does not contain a digest index"); }
+	mymaplength=(size_t) s.st_size;
+	void *p=mmap(nullptr, mymaplength, PROT_READ, MAP_SHARED, fd, 0);
+	int errcode=errno;
+	::close(fd);
+	if(MAP_FAILED==p) ERRGOSFN(errcode, path);
+	mymapping=p;
+#endif
+	try
+	{
+		int_view((const char *) mymapping, mymaplength);
+	}
+	catch(...)
+	{
+		int_unmap();
+		throw;
+	}
+#ifndef WIN32
+	// Lookups touch single pages of the table, so read ahead would only evict useful pages
+	size_t tableoffset=(size_t) myheader->tableoffset;
+	if(tableoffset<mymaplength)
+		madvise((char *) mymapping+tableoffset, mymaplength-tableoffset, MADV_RANDOM);
+#endif
+}
+
+DigestIndex::DigestIndex(const char *buffer, size_t length) : mymapping(nullptr), mymaplength(0)
+{
+	int_view(buffer, length);
+}
+
+DigestIndex::DigestIndex(DigestIndex &&o) : mymapping(o.mymapping), mymaplength(o.mymaplength), myheader(o.myheader), myfanout(o.myfanout), mytable(o.mytable), myfanoutbits(o.myfanoutbits)
+{
+	o.mymapping=nullptr;
+}
+
+DigestIndex &DigestIndex::operator=(DigestIndex &&o)
+{
+	if(this!=&o)
+	{
+		int_unmap();
+		mymapping=o.mymapping;
+		mymaplength=o.mymaplength;
+		myheader=o.myheader;
+		myfanout=o.myfanout;
+		mytable=o.mytable;
+		myfanoutbits=o.myfanoutbits;
+		o.mymapping=nullptr;
+	}
+	return *this;
+}
+
+size_t DigestIndex::int_lowerBound(const char *key) const
+{
+	const unsigned long long k=Impl::digest_index_prefix(key);
+	const size_t bucket=(size_t)(k>>(64-myfanoutbits));
+	const size_t lo=(size_t) myfanout[bucket], hi=(size_t) myfanout[bucket+1];
+	size_t n;
+	if(hi-lo<=8)
+		n=lo+Impl::digest_index_count_less(mytable+lo, hi-lo, k);
+	else
+	{
+		// The bits below the fan out bits are uniformly distributed across the bucket, so interpolate on them
+		size_t estimate=lo+(size_t) Impl::digest_index_mulhi(k<<myfanoutbits, hi-lo);
+		size_t w=std::min(estimate>lo+4 ? estimate-4 : lo, hi-8);
+		size_t c=Impl::digest_index_count_less(mytable+w, 8, k);
+		// Gallop by eight entries until the window contains the lower bound
+		while(!c && w>lo)
+		{
+			w=w>lo+8 ? w-8 : lo;
+			c=Impl::digest_index_count_less(mytable+w, 8, k);
+		}
+		while(8==c && w+8<hi)
+		{
+			w=std::min(w+8, hi-8);
+			c=Impl::digest_index_count_less(mytable+w, 8, k);
+		}
+		n=w+c;
+	}
+	// Digests sharing the first eight bytes are vanishingly rare, but order them by all their bytes
+	while(n<hi && Impl::digest_index_prefix(mytable+n)==k && memcmp(mytable+n, key, sizeof(Int256))<0)
+		n++;
+	return n;
+}
+
+size_t DigestIndex::batchContains(size_t no, const Int256 *keys, bool *results) const
+{
+	static const size_t fanoutahead=16, tableahead=8;
+	const unsigned shift=64-myfanoutbits;
+	size_t ret=0;
+	for(size_t n=0; n<std::min(no, fanoutahead); n++)
+		Impl::digest_index_prefetch(myfanout+(Impl::digest_index_prefix(keys+n)>>shift));
+	for(size_t n=0; n<no; n++)
+	{
+		// Prefetch the fan out entry far ahead, and the estimated table position of a nearer key whose fan out entry has arrived
+		if(n+fanoutahead<no)
+			Impl::digest_index_prefetch(myfanout+(Impl::digest_index_prefix(keys+n+fanoutahead)>>shift));
+		if(n+tableahead<no)
+		{
+			unsigned long long k=Impl::digest_index_prefix(keys+n+tableahead);
+			size_t bucket=(size_t)(k>>shift), lo=(size_t) myfanout[bucket], hi=(size_t) myfanout[bucket+1];
+			Impl::digest_index_prefetch(mytable+lo+(size_t) Impl::digest_index_mulhi(k<<myfanoutbits, hi-lo));
+		}
+		ret+=(results[n]=contains(keys[n]));
+	}
+	return ret;
+}
+
+} // namespace
@@ -0,0 +1,135 @@
+/* DigestIndex.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+A sorted table of 256 bit digests persisted to a file, which is memory mapped
+and searched by interpolation so lookups touch O(1) pages without loading it.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_DIGESTINDEX_H
+#define NIALLSCPP11UTILITIES_DIGESTINDEX_H
+
+/*! \file DigestIndex.hpp
+\brief Provides the DigestIndexWriter and memory mapped DigestIndex
+*/
+
+#include "Int128_256.hpp"
+#include "std_filesystem.hpp"
+#include <vector>
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	/*! \struct DigestIndexHeader
+	\brief The first 64 bytes of a digest index file, in native byte order.
+
+	The header is followed by the fan out table of (1<<fanoutbits)+1 unsigned long longs, where entry \em n is the index
+	of the first digest whose top \em fanoutbits bits are \em n. The digests follow at \em tableoffset, which is page
+	aligned, sorted in memcmp() order.
+	*/
+	struct DigestIndexHeader
+	{
+		char magic[8];					//!< "NEDDGIDX"
+		unsigned int version;			//!< Currently 1
+		unsigned int fanoutbits;		//!< Number of top bits of the digest indexing the fan out table
+		unsigned long long items;		//!< Number of digests in the table
+		unsigned long long fanoutoffset;	//!< Offset of the fan out table from the start of the file
+		unsigned long long tableoffset;	//!< Offset of the digest table from the start of the file
+		unsigned long long reserved[3];
+	};
+}
+
+/*! \class DigestIndexWriter
+\brief Collects digests and writes them out as a sorted digest index file for DigestIndex.
+
+Digests are bucket sorted by their top bits into the fan out buckets, after which each bucket is sorted and has its
+duplicates removed in parallel using OpenMP. Needs twice the memory of the digests added while writing.
+*/
+class NIALLSCPP11UTILITIES_API DigestIndexWriter
+{
+	std::vector<Int256, aligned_allocator<Int256, 32>> mydigests;
+public:
+	//! Constructs a writer, optionally reserving space for \em reserve digests
+	explicit DigestIndexWriter(size_t reserve=0) { mydigests.reserve(reserve); }
+	//! Adds a digest
+	void add(const Int256Ref &digest) { mydigests.push_back(digest.value()); }
+	//! Adds \em no digests
+	void add(size_t no, const Int256 *digests) { mydigests.insert(mydigests.end(), digests, digests+no); }
+	//! Returns the number of digests added, including duplicates
+	size_t size() const { return mydigests.size(); }
+	//! Removes all digests added
+	void clear() { mydigests.clear(); }
+	/*! Sorts the digests, removes duplicates and writes the index to \em path, returning the number of unique digests written.
+	If \em fanoutbits is zero it is chosen so each bucket averages at most 256 digests, making the fan out table
+	around 3% of the size of the digest table. The digests added are consumed.
+	*/
+	size_t write(const std::filesystem::path &path, unsigned fanoutbits=0);
+};
+
+/*! \class DigestIndex
+\brief A read only sorted digest index, usually memory mapped from a file written by DigestIndexWriter. Thread safe.
+
+Opening is constant time as only the header is validated, and the table is advised as randomly accessed to stop
+read ahead. As digests are uniformly distributed a lookup indexes the fan out table by the digest's top bits, then
+interpolates the digest's position within that bucket, which is almost always within a few entries of where it
+really is. The exact position is found by counting how many of the eight entries around the estimate are less than
+the digest, using AVX2 gathers if available, galloping by eight entries if the estimate was out. A lookup therefore
+usually touches one page of the fan out table and one page of the digest table.
+
+On an Intel Xeon virtual machine, opening an index of 16M digests (512Mb) in the page cache takes approx. 70
+microseconds, and random lookups approx. 0.25 microseconds each (batchContains() approx. 0.22 microseconds each), being
+dominated by the cost of the page touched in the table.
+*/
+class NIALLSCPP11UTILITIES_API DigestIndex
+{
+	void *mymapping;
+	size_t mymaplength;
+	const Impl::DigestIndexHeader *myheader;
+	const unsigned long long *myfanout;
+	const Int256 *mytable;
+	unsigned myfanoutbits;
+	void int_view(const char *buffer, size_t length);
+	void int_unmap();
+	// Returns the index of the first digest not less than key
+	size_t int_lowerBound(const char *key) const;
+public:
+	//! Memory maps the digest index at \em path. Throws std::invalid_argument if it is not a digest index.
+	explicit DigestIndex(const std::filesystem::path &path);
+	//! Views a digest index held in a 32 byte aligned buffer, which must outlive this object
+	DigestIndex(const char *buffer, size_t length);
+	DigestIndex(DigestIndex &&o);
+	DigestIndex &operator=(DigestIndex &&o);
+	DigestIndex(const DigestIndex &) = delete;
+	DigestIndex &operator=(const DigestIndex &) = delete;
+	~DigestIndex() { int_unmap(); }
+	//! Returns the number of digests in the index
+	size_t size() const { return (size_t) myheader->items; }
+	//! Returns true if the index has no digests
+	bool empty() const { return !myheader->items; }
+	//! Returns the number of top bits of the digest indexing the fan out table
+	unsigned fanoutBits() const { return myfanoutbits; }
+	//! Returns true if the index is memory mapped from a file rather than viewing a buffer
+	bool isMapped() const { return mymapping!=nullptr; }
+	//! Returns the digest at index \em n in sorted order
+	const Int256 &operator[](size_t n) const { return mytable[n]; }
+	//! Returns the first digest in sorted order
+	const Int256 *begin() const { return mytable; }
+	//! Returns one past the last digest in sorted order
+	const Int256 *end() const { return mytable+myheader->items; }
+	//! Returns the digest equal to \em key, or a null pointer if there is none
+	const Int256 *find(const Int256Ref &key) const
+	{
+		size_t n=int_lowerBound(key.asBytes());
+		return (n<myheader->items && !memcmp(mytable+n, key.asBytes(), sizeof(Int256))) ? mytable+n : nullptr;
+	}
+	//! Returns true if \em key is in the index
+	bool contains(const Int256Ref &key) const { return find(key)!=nullptr; }
+	//! Returns the index of the first digest not less than \em key in memcmp() order
+	size_t lowerBound(const Int256Ref &key) const { return int_lowerBound(key.asBytes()); }
+	//! Looks up \em no keys prefetching ahead, setting \em results and returning how many were found
+	size_t batchContains(size_t no, const Int256 *keys, bool *results) const;
+};
+
+} // namespace
+
+#endif
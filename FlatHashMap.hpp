@@ -0,0 +1,523 @@
+/* FlatHashMap.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Open addressing hash map and set specialised for Int128 and Int256 keys. As these
+keys are almost always the output of a hash, the bucket index and tag are taken
+directly from the key bits rather than rehashing them.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_FLATHASHMAP_H
+#define NIALLSCPP11UTILITIES_FLATHASHMAP_H
+
+/*! \file FlatHashMap.hpp
+\brief Provides the FlatHashMap and FlatHashSet open addressing containers
+*/
+
+#include "Int128_256.hpp"
+#include <iterator>
+#include <utility>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	//! Returns the index of the lowest set bit in a non-zero mask
+	inline unsigned flat_hash_lowest_bit(unsigned v)
+	{
+#ifdef _MSC_VER
+		unsigned long ret;
+		_BitScanForward(&ret, v);
+		return (unsigned) ret;
+#elif defined(__GNUC__)
+		return (unsigned) __builtin_ctz(v);
+#else
+		unsigned ret=0;
+		while(!(v & 1)) { v>>=1; ret++; }
+		return ret;
+#endif
+	}
+
+	/*! \struct FlatHashGroup
+	\brief A group of sixteen control bytes which are probed together with a single SIMD compare.
+
+	Full slots hold a seven bit tag from the key, free slots have their top bit set.
+	*/
+	struct FlatHashGroup
+	{
+		enum { width=16 };
+		static const signed char empty=-128;
+		static const signed char deleted=-2;
+#if HAVE_M128
+		__m128i ctrl;
+		explicit FlatHashGroup(const signed char *p) : ctrl(_mm_load_si128((const __m128i *) p)) { }
+		//! Returns a bitmask of the slots matching \em tag
+		unsigned match(signed char tag) const { return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))); }
+		//! Returns a bitmask of the slots which are empty or deleted
+		unsigned matchFree() const { return (unsigned) _mm_movemask_epi8(ctrl); }
+#elif HAVE_NEON128
+		int8x16_t ctrl;
+		explicit FlatHashGroup(const signed char *p) : ctrl(vld1q_s8((const int8_t *) p)) { }
+		unsigned match(signed char tag) const { return _mm_movemask_epi8_neon(vreinterpretq_u32_u8(vceqq_s8(ctrl, vdupq_n_s8(tag)))); }
+		unsigned matchFree() const { return _mm_movemask_epi8_neon(vreinterpretq_u32_s8(vshrq_n_s8(ctrl, 7))); }
+#else
+		const signed char *ctrl;
+		explicit FlatHashGroup(const signed char *p) : ctrl(p) { }
+		unsigned match(signed char tag) const
+		{
+			unsigned ret=0;
+			for(int n=0; n<width; n++)
+				if(ctrl[n]==tag) ret|=1U<<n;
+			return ret;
+		}
+		unsigned matchFree() const
+		{
+			unsigned ret=0;
+			for(int n=0; n<width; n++)
+				if(ctrl[n]<0) ret|=1U<<n;
+			return ret;
+		}
+#endif
+		//! Returns a bitmask of the slots which have never been used
+		unsigned matchEmpty() const { return match(empty); }
+	};
+
+	template<class Key, class T> struct FlatHashMapPolicy
+	{
+		typedef Key key_type;
+		typedef std::pair<const Key, T> value_type;
+		static const key_type &key(const value_type &v) { return v.first; }
+	};
+	template<class Key> struct FlatHashSetPolicy
+	{
+		typedef Key key_type;
+		typedef Key value_type;
+		static const key_type &key(const value_type &v) { return v; }
+	};
+
+	/*! \class FlatHashTable
+	\brief The open addressing table implementing FlatHashMap and FlatHashSet.
+
+	Slots are arranged in groups of sixteen with a parallel array of control bytes. The low bits
+	of the hash select the group, the top seven bits form a tag stored in the control byte, and a
+	lookup compares all sixteen tags of a group at once. Groups are probed triangularly and a probe
+	terminates at the first group containing an empty slot.
+	*/
+	template<class Policy, class Hash, class KeyEqual> class FlatHashTable
+	{
+	public:
+		typedef typename Policy::key_type key_type;
+		typedef typename Policy::value_type value_type;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+		typedef Hash hasher;
+		typedef KeyEqual key_equal;
+		typedef value_type &reference;
+		typedef const value_type &const_reference;
+		typedef value_type *pointer;
+		typedef const value_type *const_pointer;
+	protected:
+		typedef aligned_allocator<signed char, 32> ctrl_allocator;
+		typedef aligned_allocator<value_type, (std::alignment_of<value_type>::value>32) ? std::alignment_of<value_type>::value : 32> slot_allocator;
+		signed char *_ctrl;
+		value_type *_slots;
+		size_type _capacity, _size, _growth_left;
+		Hash _hasher;
+		KeyEqual _equal;
+
+		static signed char int_tag(size_t h) { return (signed char)(h >> (8*sizeof(size_t)-7)); }
+		static size_type int_growth(size_type capacity) { return capacity-capacity/8; }
+		size_type int_groupmask() const { return _capacity/FlatHashGroup::width-1; }
+		template<class K> size_type int_find(const K &k, size_t h) const
+		{
+			if(!_capacity) return _capacity;
+			const signed char tag=int_tag(h);
+			const size_type groupmask=int_groupmask();
+			for(size_type g=h & groupmask, step=0;; g=(g+(++step)) & groupmask)
+			{
+				FlatHashGroup group(_ctrl+g*FlatHashGroup::width);
+				for(unsigned m=group.match(tag); m; m&=m-1)
+				{
+					size_type idx=g*FlatHashGroup::width+flat_hash_lowest_bit(m);
+					if(_equal(Policy::key(_slots[idx]), k))
+						return idx;
+				}
+				if(group.matchEmpty())
+					return _capacity;
+			}
+		}
+		// Returns the first free slot for a hash known not to be in the table
+		size_type int_find_free(size_t h) const
+		{
+			const size_type groupmask=int_groupmask();
+			for(size_type g=h & groupmask, step=0;; g=(g+(++step)) & groupmask)
+			{
+				unsigned m=FlatHashGroup(_ctrl+g*FlatHashGroup::width).matchFree();
+				if(m)
+					return g*FlatHashGroup::width+flat_hash_lowest_bit(m);
+			}
+		}
+		void int_allocate(size_type capacity)
+		{
+			_capacity=capacity;
+			_growth_left=int_growth(capacity);
+			if(!capacity)
+			{
+				_ctrl=nullptr;
+				_slots=nullptr;
+				return;
+			}
+			_ctrl=ctrl_allocator().allocate(capacity);
+			try
+			{
+				_slots=slot_allocator().allocate(capacity);
+			}
+			catch(...)
+			{
+				ctrl_allocator().deallocate(_ctrl, capacity);
+				throw;
+			}
+			memset(_ctrl, FlatHashGroup::empty, capacity);
+		}
+		void int_destroy()
+		{
+			if(!_capacity) return;
+			for(size_type n=0; n<_capacity; n++)
+				if(_ctrl[n]>=0)
+					_slots[n].~value_type();
+			slot_allocator().deallocate(_slots, _capacity);
+			ctrl_allocator().deallocate(_ctrl, _capacity);
+		}
+		void int_rehash(size_type capacity)
+		{
+			signed char *oldctrl=_ctrl;
+			value_type *oldslots=_slots;
+			size_type oldcapacity=_capacity;
+			int_allocate(capacity);
+			for(size_type n=0; n<oldcapacity; n++)
+			{
+				if(oldctrl[n]<0) continue;
+				size_t h=_hasher(Policy::key(oldslots[n]));
+				size_type idx=int_find_free(h);
+				::new(_slots+idx) value_type(std::move(oldslots[n]));
+				_ctrl[idx]=int_tag(h);
+				oldslots[n].~value_type();
+			}
+			_growth_left-=_size;
+			if(oldcapacity)
+			{
+				slot_allocator().deallocate(oldslots, oldcapacity);
+				ctrl_allocator().deallocate(oldctrl, oldcapacity);
+			}
+		}
+		static size_type int_capacity_for(size_type no)
+		{
+			size_type capacity=FlatHashGroup::width;
+			while(int_growth(capacity)<no)
+				capacity<<=1;
+			return capacity;
+		}
+		// Inserts \em k if not present, constructing the value using \em make
+		template<class K, class Maker> std::pair<size_type, bool> int_insert(const K &k, Maker &&make)
+		{
+			size_t h=_hasher(k);
+			size_type idx=int_find(k, h);
+			if(idx!=_capacity)
+				return std::make_pair(idx, false);
+			if(!_growth_left)
+			{
+				// Purge tombstones in place if they make up most of the used slots, else grow
+				int_rehash((_capacity && _size<int_growth(_capacity)/2) ? _capacity : (_capacity ? _capacity*2 : FlatHashGroup::width));
+			}
+			idx=int_find_free(h);
+			make(_slots+idx);
+			if(_ctrl[idx]==FlatHashGroup::empty)
+				_growth_left--;
+			_ctrl[idx]=int_tag(h);
+			_size++;
+			return std::make_pair(idx, true);
+		}
+		void int_erase(size_type idx)
+		{
+			_slots[idx].~value_type();
+			_size--;
+			// If this slot's group has an empty slot, no probe sequence ever passed through it
+			size_type groupstart=idx & ~(size_type)(FlatHashGroup::width-1);
+			if(FlatHashGroup(_ctrl+groupstart).matchEmpty())
+			{
+				_ctrl[idx]=FlatHashGroup::empty;
+				_growth_left++;
+			}
+			else
+				_ctrl[idx]=FlatHashGroup::deleted;
+		}
+
+		template<bool is_const> class iterator_impl
+		{
+			friend class FlatHashTable;
+			typedef typename std::conditional<is_const, const FlatHashTable, FlatHashTable>::type table_type;
+			table_type *_table;
+			size_type _idx;
+			void int_skip() { while(_idx<_table->_capacity && _table->_ctrl[_idx]<0) _idx++; }
+			iterator_impl(table_type *table, size_type idx) : _table(table), _idx(idx) { }
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef typename FlatHashTable::value_type value_type;
+			typedef typename FlatHashTable::difference_type difference_type;
+			typedef typename std::conditional<is_const, const value_type *, value_type *>::type pointer;
+			typedef typename std::conditional<is_const, const value_type &, value_type &>::type reference;
+			friend class iterator_impl<!is_const>;
+			iterator_impl() : _table(nullptr), _idx(0) { }
+			iterator_impl(const iterator_impl<false> &o) : _table(o._table), _idx(o._idx) { }
+			reference operator*() const { return _table->_slots[_idx]; }
+			pointer operator->() const { return _table->_slots+_idx; }
+			iterator_impl &operator++() { _idx++; int_skip(); return *this; }
+			iterator_impl operator++(int) { iterator_impl ret(*this); ++*this; return ret; }
+			friend bool operator==(const iterator_impl &a, const iterator_impl &b) { return a._idx==b._idx; }
+			friend bool operator!=(const iterator_impl &a, const iterator_impl &b) { return a._idx!=b._idx; }
+		};
+	public:
+		typedef iterator_impl<false> iterator;
+		typedef iterator_impl<true> const_iterator;
+	protected:
+		iterator int_iterator(size_type idx) { return iterator(this, idx); }
+	public:
+
+		explicit FlatHashTable(size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : _size(0), _hasher(hash), _equal(equal)
+		{
+			int_allocate(no ? int_capacity_for(no) : 0);
+		}
+		FlatHashTable(const FlatHashTable &o) : _size(0), _hasher(o._hasher), _equal(o._equal)
+		{
+			int_allocate(o._capacity);
+			try
+			{
+				// Tombstones are copied too, as probes for items placed after them must still pass through
+				for(size_type n=0; n<_capacity; n++)
+				{
+					if(o._ctrl[n]>=0)
+					{
+						::new(_slots+n) value_type(o._slots[n]);
+						_size++;
+					}
+					_ctrl[n]=o._ctrl[n];
+				}
+			}
+			catch(...)
+			{
+				int_destroy();
+				throw;
+			}
+			_growth_left=o._growth_left;
+		}
+		FlatHashTable(FlatHashTable &&o) : _ctrl(o._ctrl), _slots(o._slots), _capacity(o._capacity), _size(o._size), _growth_left(o._growth_left), _hasher(std::move(o._hasher)), _equal(std::move(o._equal))
+		{
+			o._size=0;
+			o.int_allocate(0);
+		}
+		FlatHashTable &operator=(const FlatHashTable &o)
+		{
+			if(this!=&o)
+			{
+				FlatHashTable temp(o);
+				swap(temp);
+			}
+			return *this;
+		}
+		FlatHashTable &operator=(FlatHashTable &&o)
+		{
+			swap(o);
+			return *this;
+		}
+		~FlatHashTable() { int_destroy(); }
+		void swap(FlatHashTable &o)
+		{
+			std::swap(_ctrl, o._ctrl);
+			std::swap(_slots, o._slots);
+			std::swap(_capacity, o._capacity);
+			std::swap(_size, o._size);
+			std::swap(_growth_left, o._growth_left);
+			std::swap(_hasher, o._hasher);
+			std::swap(_equal, o._equal);
+		}
+
+		iterator begin() { iterator ret(this, 0); ret.int_skip(); return ret; }
+		const_iterator begin() const { const_iterator ret(this, 0); ret.int_skip(); return ret; }
+		const_iterator cbegin() const { return begin(); }
+		iterator end() { return iterator(this, _capacity); }
+		const_iterator end() const { return const_iterator(this, _capacity); }
+		const_iterator cend() const { return end(); }
+
+		bool empty() const { return !_size; }
+		size_type size() const { return _size; }
+		size_type max_size() const { return slot_allocator().max_size(); }
+		//! Returns the number of slots in the table
+		size_type bucket_count() const { return _capacity; }
+		float load_factor() const { return _capacity ? (float) _size/_capacity : 0.0f; }
+		//! The maximum load factor is fixed at 7/8
+		float max_load_factor() const { return 0.875f; }
+		//! Returns the bytes of storage used by the table, excluding anything owned by the values
+		size_type memory_usage() const { return _capacity*(sizeof(value_type)+1); }
+		hasher hash_function() const { return _hasher; }
+		key_equal key_eq() const { return _equal; }
+
+		void clear()
+		{
+			for(size_type n=0; n<_capacity; n++)
+			{
+				if(_ctrl[n]>=0)
+					_slots[n].~value_type();
+			}
+			if(_capacity)
+				memset(_ctrl, FlatHashGroup::empty, _capacity);
+			_size=0;
+			_growth_left=int_growth(_capacity);
+		}
+		//! Ensures at least \em no items can be stored without rehashing
+		void reserve(size_type no)
+		{
+			if(no>int_growth(_capacity))
+				int_rehash(int_capacity_for(no));
+		}
+		//! Rehashes the table to store at least \em no items, purging any deleted slots
+		void rehash(size_type no)
+		{
+			size_type capacity=int_capacity_for(no<_size ? _size : no);
+			int_rehash(_size ? capacity : (no ? capacity : 0));
+		}
+
+		iterator find(const key_type &k) { return iterator(this, int_find(k, _hasher(k))); }
+		const_iterator find(const key_type &k) const { return const_iterator(this, int_find(k, _hasher(k))); }
+		size_type count(const key_type &k) const { return int_find(k, _hasher(k))!=_capacity; }
+		//! Finds an equivalent key without constructing a key_type e.g. using an Int256Ref. Requires transparent Hash and KeyEqual.
+		template<class K, class H=Hash, class E=KeyEqual, class=typename H::is_transparent, class=typename E::is_transparent> iterator find(const K &k) { return iterator(this, int_find(k, _hasher(k))); }
+		//! Finds an equivalent key without constructing a key_type e.g. using an Int256Ref. Requires transparent Hash and KeyEqual.
+		template<class K, class H=Hash, class E=KeyEqual, class=typename H::is_transparent, class=typename E::is_transparent> const_iterator find(const K &k) const { return const_iterator(this, int_find(k, _hasher(k))); }
+		//! Counts an equivalent key without constructing a key_type e.g. using an Int256Ref. Requires transparent Hash and KeyEqual.
+		template<class K, class H=Hash, class E=KeyEqual, class=typename H::is_transparent, class=typename E::is_transparent> size_type count(const K &k) const { return int_find(k, _hasher(k))!=_capacity; }
+		std::pair<iterator, iterator> equal_range(const key_type &k)
+		{
+			iterator it=find(k), e=it;
+			if(it!=end()) ++e;
+			return std::make_pair(it, e);
+		}
+		std::pair<const_iterator, const_iterator> equal_range(const key_type &k) const
+		{
+			const_iterator it=find(k), e=it;
+			if(it!=end()) ++e;
+			return std::make_pair(it, e);
+		}
+
+		std::pair<iterator, bool> insert(const value_type &v)
+		{
+			auto ret=int_insert(Policy::key(v), [&v](value_type *p) { ::new(p) value_type(v); });
+			return std::make_pair(iterator(this, ret.first), ret.second);
+		}
+		std::pair<iterator, bool> insert(value_type &&v)
+		{
+			auto ret=int_insert(Policy::key(v), [&v](value_type *p) { ::new(p) value_type(std::move(v)); });
+			return std::make_pair(iterator(this, ret.first), ret.second);
+		}
+		template<class InputIterator> void insert(InputIterator first, InputIterator last)
+		{
+			for(; first!=last; ++first)
+				insert(*first);
+		}
+		template<class... Args> std::pair<iterator, bool> emplace(Args &&... args)
+		{
+			return insert(value_type(std::forward<Args>(args)...));
+		}
+
+		iterator erase(const_iterator it)
+		{
+			int_erase(it._idx);
+			iterator ret(this, it._idx);
+			ret.int_skip();
+			return ret;
+		}
+		size_type erase(const key_type &k)
+		{
+			size_type idx=int_find(k, _hasher(k));
+			if(idx==_capacity) return 0;
+			int_erase(idx);
+			return 1;
+		}
+	};
+}
+
+/*! \class FlatHashMap
+\brief An open addressing hash map for Int128, Int256 and their Hash128 and Hash256 derivatives.
+
+Unlike std::unordered_map there is no allocation per item: items live in one contiguous 32 byte aligned
+array of slots allocated via aligned_allocator, with a parallel array of control bytes holding a seven bit tag
+per slot. A lookup takes the group of sixteen slots from the low bits of the hash, compares all sixteen tags at
+once using SSE2 or NEON, and only then compares keys. The default std::hash of Int128 and Int256 takes its value
+straight from the key bits, so if your keys are not already uniformly random (e.g. counters) you should supply
+mixing_hash, or select it for std::hash with hash_selector.
+
+Iterators and references are invalidated by any insertion which grows the table. Erasure only invalidates
+iterators to the erased item.
+*/
+template<class Key, class T, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>> class FlatHashMap : public Impl::FlatHashTable<Impl::FlatHashMapPolicy<Key, T>, Hash, KeyEqual>
+{
+	typedef Impl::FlatHashTable<Impl::FlatHashMapPolicy<Key, T>, Hash, KeyEqual> Base;
+public:
+	typedef T mapped_type;
+	typedef typename Base::key_type key_type;
+	typedef typename Base::value_type value_type;
+	typedef typename Base::size_type size_type;
+	typedef typename Base::iterator iterator;
+	typedef typename Base::const_iterator const_iterator;
+
+	//! Constructs a map able to hold \em no items without rehashing
+	explicit FlatHashMap(size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no, hash, equal) { }
+	template<class InputIterator> FlatHashMap(InputIterator first, InputIterator last, size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no, hash, equal) { Base::insert(first, last); }
+	FlatHashMap(std::initializer_list<value_type> il, size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no ? no : il.size(), hash, equal) { Base::insert(il.begin(), il.end()); }
+
+	//! Inserts a value constructed from \em args if \em k is not already present
+	template<class... Args> std::pair<iterator, bool> try_emplace(const key_type &k, Args &&... args)
+	{
+		auto ret=Base::int_insert(k, [&](value_type *p) { ::new(p) value_type(std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...)); });
+		return std::make_pair(Base::int_iterator(ret.first), ret.second);
+	}
+	mapped_type &operator[](const key_type &k) { return try_emplace(k).first->second; }
+	mapped_type &at(const key_type &k)
+	{
+		size_type idx=Base::int_find(k, Base::_hasher(k));
+		if(idx==Base::_capacity) throw std::out_of_range("Key not found in FlatHashMap");
+		return Base::_slots[idx].second;
+	}
+	const mapped_type &at(const key_type &k) const
+	{
+		size_type idx=Base::int_find(k, Base::_hasher(k));
+		if(idx==Base::_capacity) throw std::out_of_range("Key not found in FlatHashMap");
+		return Base::_slots[idx].second;
+	}
+};
+
+/*! \class FlatHashSet
+\brief An open addressing hash set for Int128, Int256 and their Hash128 and Hash256 derivatives.
+
+\sa FlatHashMap
+*/
+template<class Key, class Hash=std::hash<Key>, class KeyEqual=std::equal_to<Key>> class FlatHashSet : public Impl::FlatHashTable<Impl::FlatHashSetPolicy<Key>, Hash, KeyEqual>
+{
+	typedef Impl::FlatHashTable<Impl::FlatHashSetPolicy<Key>, Hash, KeyEqual> Base;
+public:
+	typedef typename Base::value_type value_type;
+	typedef typename Base::size_type size_type;
+
+	//! Constructs a set able to hold \em no items without rehashing
+	explicit FlatHashSet(size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no, hash, equal) { }
+	template<class InputIterator> FlatHashSet(InputIterator first, InputIterator last, size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no, hash, equal) { Base::insert(first, last); }
+	FlatHashSet(std::initializer_list<value_type> il, size_type no=0, const Hash &hash=Hash(), const KeyEqual &equal=KeyEqual()) : Base(no ? no : il.size(), hash, equal) { Base::insert(il.begin(), il.end()); }
+};
+
+template<class Key, class T, class Hash, class KeyEqual> inline void swap(FlatHashMap<Key, T, Hash, KeyEqual> &a, FlatHashMap<Key, T, Hash, KeyEqual> &b) { a.swap(b); }
+template<class Key, class Hash, class KeyEqual> inline void swap(FlatHashSet<Key, Hash, KeyEqual> &a, FlatHashSet<Key, Hash, KeyEqual> &b) { a.swap(b); }
+
+} // namespace
+
+#endif
@@ -0,0 +1,154 @@
+/* HugePageAllocator.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Maps large allocations in huge pages, and reports how much of them the kernel
+actually backed with huge pages.
+*/
+
+#include "HugePageAllocator.hpp"
+#include <stdio.h>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	static inline size_t hugepage_round(size_t bytes)
+	{
+		return (bytes+hugepage_size-1) & ~(hugepage_size-1);
+	}
+
+#ifdef WIN32
+	// Large pages need the SeLockMemoryPrivilege, which is only enabled once
+	static bool hugepage_enable_privilege()
+	{
+		static int enabled=-1;
+		if(enabled<0)
+		{
+			HANDLE token;
+			TOKEN_PRIVILEGES tp;
+			enabled=0;
+			if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &token))
+			{
+				tp.PrivilegeCount=1;
+				tp.Privileges[0].Attributes=SE_PRIVILEGE_ENABLED;
+				if(LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+					&& AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) && GetLastError()==ERROR_SUCCESS)
+					enabled=1;
+				CloseHandle(token);
+			}
+		}
+		return enabled>0;
+	}
+	void *hugepage_allocate(size_t bytes, HugePagePolicy policy)
+	{
+		size_t length=hugepage_round(bytes);
+		void *ret=nullptr;
+		if(HugePagePolicy::Reserved==policy && GetLargePageMinimum()==hugepage_size && hugepage_enable_privilege())
+			ret=VirtualAlloc(NULL, length, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+		// Windows has no transparent huge pages, so everything else gets normal pages
+		if(!ret)
+			ret=VirtualAlloc(NULL, length, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+		if(!ret) throw std::bad_alloc();
+		return ret;
+	}
+	void hugepage_deallocate(void *p, size_t bytes) noexcept
+	{
+		VirtualFree(p, 0, MEM_RELEASE);
+	}
+	size_t hugepage_backed_bytes(const void *p, size_t bytes)
+	{
+		// Large pages are locked, so the whole allocation either is or is not made of them
+		PSAPI_WORKING_SET_EX_INFORMATION info;
+		info.VirtualAddress=const_cast<void *>(p);
+		if(!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)) || !info.VirtualAttributes.Valid)
+			return 0;
+		return info.VirtualAttributes.LargePage ? bytes : 0;
+	}
+#elif defined(__linux__)
+	void *hugepage_allocate(size_t bytes, HugePagePolicy policy)
+	{
+		size_t length=hugepage_round(bytes);
+#ifdef MAP_HUGETLB
+		if(HugePagePolicy::Reserved==policy)
+		{
+			int flags=MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+			flags|=MAP_HUGE_2MB;
+#endif
+			// Fails with ENOMEM if the reserved pool has too few free pages
+			void *ret=mmap(nullptr, length, PROT_READ|PROT_WRITE, flags, -1, 0);
+			if(MAP_FAILED!=ret)
+				return ret;
+		}
+#endif
+		// Map a huge page more than needed and trim the ends so what remains is huge page aligned
+		char *mem=(char *) mmap(nullptr, length+hugepage_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if(MAP_FAILED==(void *) mem) throw std::bad_alloc();
+		char *ret=(char *)(((size_t) mem+hugepage_size-1) & ~(hugepage_size-1));
+		if(ret>mem)
+			munmap(mem, ret-mem);
+		if(mem+hugepage_size>ret)
+			munmap(ret+length, mem+hugepage_size-ret);
+#ifdef MADV_HUGEPAGE
+		// Fails harmlessly with EINVAL if the kernel has no transparent huge page support
+		madvise(ret, length, MADV_HUGEPAGE);
+#endif
+		return ret;
+	}
+	void hugepage_deallocate(void *p, size_t bytes) noexcept
+	{
+		munmap(p, hugepage_round(bytes));
+	}
+	size_t hugepage_backed_bytes(const void *p, size_t bytes)
+	{
+		FILE *fh=fopen("/proc/self/smaps", "r");
+		if(!fh) return 0;
+		auto unfh=Undoer([fh] { fclose(fh); });
+		const size_t begin=(size_t) p, end=begin+hugepage_round(bytes);
+		size_t ret=0, overlap=0, huge=0;
+		char line[512];
+		while(fgets(line, sizeof(line), fh))
+		{
+			unsigned long start, finish, kb;
+			// Each mapping starts with a line of hexstart-hexend perms ..., followed by lines of Field: value kB
+			if(2==sscanf(line, "%lx-%lx ", &start, &finish))
+			{
+				ret+=huge<overlap ? huge : overlap;
+				overlap=huge=0;
+				if(finish>begin && start<end)
+					overlap=(finish<end ? finish : end)-(start>begin ? start : begin);
+			}
+			else if(overlap && (1==sscanf(line, "AnonHugePages: %lu kB", &kb) || 1==sscanf(line, "Private_Hugetlb: %lu kB", &kb) || 1==sscanf(line, "Shared_Hugetlb: %lu kB", &kb)))
+				huge+=(size_t) kb*1024;
+		}
+		// Adjacent mappings may have been merged, so a mapping's huge pages may not all be within the allocation
+		ret+=huge<overlap ? huge : overlap;
+		return ret<bytes ? ret : bytes;
+	}
+#else
+	// Without huge page support these are plain page aligned allocations
+	void *hugepage_allocate(size_t bytes, HugePagePolicy policy)
+	{
+		void *ret=detail::allocate_aligned_memory(4096, hugepage_round(bytes));
+		if(!ret) throw std::bad_alloc();
+		return ret;
+	}
+	void hugepage_deallocate(void *p, size_t bytes) noexcept
+	{
+		detail::deallocate_aligned_memory(p);
+	}
+	size_t hugepage_backed_bytes(const void *p, size_t bytes)
+	{
+		return 0;
+	}
+#endif
+}
+
+} // namespace
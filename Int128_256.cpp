@@ -9,6 +9,7 @@ which isn't fast, but it's the fastest reasonably good 256 bit hash I can make q
 */
 
 #include "Int128_256.hpp"
+#include <atomic>
 #ifdef _MSC_VER
 #pragma warning(push, 0)
 #endif
@@ -30,8 +31,32 @@ which isn't fast, but it's the fastest reasonably good 256 bit hash I can make q
 #include <random>
 #ifdef WIN32
 #include <malloc.h>
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
 #else
 #include <alloca.h>
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HAVE_AESNI_INTRINSICS 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define AESNI_TARGET
+#else
+#include <cpuid.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define AESNI_TARGET __attribute__((target("aes,ssse3")))
+#endif
+#else
+#define HAVE_AESNI_INTRINSICS 0
 #endif
 
 #if ALLOW_UNALIGNED_READS
@@ -40,101 +65,650 @@ which isn't fast, but it's the fastest reasonably good 256 bit hash I can make q
 
 namespace NiallsCPP11Utilities {
 
-template<class generator_type> void FillRandom(char *buffer, size_t length)
+// Fills a buffer with entropy from getrandom() if available, else std::random_device
+static void OSEntropy(void *_buffer, size_t length)
+{
+	char *buffer=(char *) _buffer;
+#if defined(__linux__) && defined(SYS_getrandom)
+	while(length)
+	{
+		long ret=syscall(SYS_getrandom, buffer, length, 0);
+		if(ret<0)
+		{
+			if(EINTR==errno) continue;
+			break;	// ENOSYS on kernels before 3.17
+		}
+		buffer+=ret;
+		length-=(size_t) ret;
+	}
+#endif
+	random_device rd;
+	for(; length; )
+	{
+		unsigned int v=rd();
+		size_t thislength=length<sizeof(v) ? length : sizeof(v);
+		memcpy(buffer, &v, thislength);
+		buffer+=thislength;
+		length-=thislength;
+	}
+}
+
+/* Philox4x32-10 counter based generator from Salmon, Moraes, Dror and Shaw (2011) "Parallel random numbers:
+as easy as 1, 2, 3". Each 128 bit block of output is a pure function of a 64 bit key and a 128 bit counter, so
+any block of the stream can be generated by any thread independently of all the others. We use the block index
+as the counter and the seed as the key, so block zero with a zero seed matches the Random123 known answer test.
+*/
+namespace Philox
+{
+	static const uint32_t M0=0xD2511F53, M1=0xCD9E8D57, W0=0x9E3779B9, W1=0xBB67AE85;
+
+	// Generates the single block at counter ctr
+	static inline void Block(uint32_t *out, unsigned long long ctr, unsigned long long seed)
+	{
+		uint32_t c0=(uint32_t) ctr, c1=(uint32_t)(ctr>>32), c2=0, c3=0;
+		uint32_t k0=(uint32_t) seed, k1=(uint32_t)(seed>>32);
+		for(int r=0; r<10; r++)
+		{
+			if(r) { k0+=W0; k1+=W1; }
+			uint64_t p0=(uint64_t) M0*c0, p1=(uint64_t) M1*c2;
+			uint32_t n0=(uint32_t)(p1>>32)^c1^k0, n2=(uint32_t)(p0>>32)^c3^k1;
+			c1=(uint32_t) p1;
+			c3=(uint32_t) p0;
+			c0=n0;
+			c2=n2;
+		}
+		out[0]=c0; out[1]=c1; out[2]=c2; out[3]=c3;
+	}
+#if HAVE_M256
+	static inline void MulHiLo(__m256i a, __m256i m, __m256i &lo, __m256i &hi)
+	{
+		__m256i p02=_mm256_mul_epu32(a, m), p13=_mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+		p02=_mm256_shuffle_epi32(p02, _MM_SHUFFLE(3, 1, 2, 0));
+		p13=_mm256_shuffle_epi32(p13, _MM_SHUFFLE(3, 1, 2, 0));
+		lo=_mm256_unpacklo_epi32(p02, p13);
+		hi=_mm256_unpackhi_epi32(p02, p13);
+	}
+	// Generates the eight blocks starting at counter ctr, one per 32 bit lane
+	static inline void Blocks8(uint32_t *out, unsigned long long ctr, unsigned long long seed)
+	{
+		TYPEALIGNMENT(32) uint32_t lows[8], highs[8];
+		for(int n=0; n<8; n++)
+		{
+			lows[n]=(uint32_t)(ctr+n);
+			highs[n]=(uint32_t)((ctr+n)>>32);
+		}
+		__m256i c0=_mm256_load_si256((const __m256i *) lows), c1=_mm256_load_si256((const __m256i *) highs), c2=_mm256_setzero_si256(), c3=c2;
+		const __m256i m0=_mm256_set1_epi32((int) M0), m1=_mm256_set1_epi32((int) M1);
+		uint32_t k0=(uint32_t) seed, k1=(uint32_t)(seed>>32);
+		for(int r=0; r<10; r++)
+		{
+			if(r) { k0+=W0; k1+=W1; }
+			__m256i lo0, hi0, lo1, hi1;
+			MulHiLo(c0, m0, lo0, hi0);
+			MulHiLo(c2, m1, lo1, hi1);
+			c0=_mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int) k0));
+			c1=lo1;
+			c2=_mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int) k1));
+			c3=lo0;
+		}
+		// Transpose lanes into blocks. Each 128 bit half transposes separately, so b0 holds blocks 0 and 4 etc.
+		__m256i t0=_mm256_unpacklo_epi32(c0, c1), t1=_mm256_unpacklo_epi32(c2, c3);
+		__m256i t2=_mm256_unpackhi_epi32(c0, c1), t3=_mm256_unpackhi_epi32(c2, c3);
+		__m256i b0=_mm256_unpacklo_epi64(t0, t1), b1=_mm256_unpackhi_epi64(t0, t1);
+		__m256i b2=_mm256_unpacklo_epi64(t2, t3), b3=_mm256_unpackhi_epi64(t2, t3);
+		_mm256_storeu_si256((__m256i *) out, _mm256_permute2x128_si256(b0, b1, 0x20));
+		_mm256_storeu_si256((__m256i *)(out+8), _mm256_permute2x128_si256(b2, b3, 0x20));
+		_mm256_storeu_si256((__m256i *)(out+16), _mm256_permute2x128_si256(b0, b1, 0x31));
+		_mm256_storeu_si256((__m256i *)(out+24), _mm256_permute2x128_si256(b2, b3, 0x31));
+	}
+#endif
+#if HAVE_M128
+	static inline void MulHiLo(__m128i a, __m128i m, __m128i &lo, __m128i &hi)
+	{
+		__m128i p02=_mm_mul_epu32(a, m), p13=_mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+		p02=_mm_shuffle_epi32(p02, _MM_SHUFFLE(3, 1, 2, 0));
+		p13=_mm_shuffle_epi32(p13, _MM_SHUFFLE(3, 1, 2, 0));
+		lo=_mm_unpacklo_epi32(p02, p13);
+		hi=_mm_unpackhi_epi32(p02, p13);
+	}
+	// Generates the four blocks starting at counter ctr, one per 32 bit lane
+	static inline void Blocks4(uint32_t *out, unsigned long long ctr, unsigned long long seed)
+	{
+		TYPEALIGNMENT(16) uint32_t lows[4], highs[4];
+		for(int n=0; n<4; n++)
+		{
+			lows[n]=(uint32_t)(ctr+n);
+			highs[n]=(uint32_t)((ctr+n)>>32);
+		}
+		__m128i c0=_mm_load_si128((const __m128i *) lows), c1=_mm_load_si128((const __m128i *) highs), c2=_mm_setzero_si128(), c3=c2;
+		const __m128i m0=_mm_set1_epi32((int) M0), m1=_mm_set1_epi32((int) M1);
+		uint32_t k0=(uint32_t) seed, k1=(uint32_t)(seed>>32);
+		for(int r=0; r<10; r++)
+		{
+			if(r) { k0+=W0; k1+=W1; }
+			__m128i lo0, hi0, lo1, hi1;
+			MulHiLo(c0, m0, lo0, hi0);
+			MulHiLo(c2, m1, lo1, hi1);
+			c0=_mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int) k0));
+			c1=lo1;
+			c2=_mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int) k1));
+			c3=lo0;
+		}
+		// Transpose lanes into blocks
+		__m128i t0=_mm_unpacklo_epi32(c0, c1), t1=_mm_unpacklo_epi32(c2, c3);
+		__m128i t2=_mm_unpackhi_epi32(c0, c1), t3=_mm_unpackhi_epi32(c2, c3);
+		_mm_storeu_si128((__m128i *) out, _mm_unpacklo_epi64(t0, t1));
+		_mm_storeu_si128((__m128i *)(out+4), _mm_unpackhi_epi64(t0, t1));
+		_mm_storeu_si128((__m128i *)(out+8), _mm_unpacklo_epi64(t2, t3));
+		_mm_storeu_si128((__m128i *)(out+12), _mm_unpackhi_epi64(t2, t3));
+	}
+#endif
+	// Generates no blocks starting at counter ctr on this thread
+	static void Fill(uint32_t *out, size_t no, unsigned long long ctr, unsigned long long seed)
+	{
+#if HAVE_M256
+		for(; no>=8; no-=8, ctr+=8, out+=32)
+			Blocks8(out, ctr, seed);
+#endif
+#if HAVE_M128
+		for(; no>=4; no-=4, ctr+=4, out+=16)
+			Blocks4(out, ctr, seed);
+#endif
+		for(; no; no--, ctr++, out+=4)
+			Block(out, ctr, seed);
+	}
+	// Generates no blocks starting at counter ctr using all available threads
+	static void ParallelFill(uint32_t *out, size_t no, unsigned long long ctr, unsigned long long seed)
+	{
+		// 64Kb per work item is enough to amortise the thread dispatch
+		const size_t chunk=4096;
+		if(no<=chunk)
+		{
+			Fill(out, no, ctr, seed);
+			return;
+		}
+		const ptrdiff_t chunks=(ptrdiff_t)((no+chunk-1)/chunk);
+#pragma omp parallel for schedule(static)
+		for(ptrdiff_t n=0; n<chunks; n++)
+		{
+			size_t start=n*chunk, thisno=no-start;
+			if(thisno>chunk) thisno=chunk;
+			Fill(out+4*start, thisno, ctr+start, seed);
+		}
+	}
+}
+
+/* Cryptographically strong generators for FillQualityRandom(). Where the CPU has AES-NI we use the CTR_DRBG
+of NIST SP 800-90A with AES-128 and no derivation function, otherwise a ChaCha20 generator in Bernstein's "fast
+key erasure" configuration. Both rekey themselves after every request so earlier output cannot be recovered from
+a later compromise of their state, and both reseed from the OS every reseed_interval requests.
+*/
+namespace QualityRandom
 {
-	// No speed benefit so disabled
-//#pragma omp parallel if(0 && length>=1024) num_threads((int)(length/256)) schedule(dynamic)
+	static const size_t max_request=65536;		// NIST's 2^19 bit maximum request for AES
+	static const size_t reseed_interval=65536;	// So at most 4Gb of output between reseeds
+
+#if HAVE_AESNI_INTRINSICS
+	// True if the CPU has AES-NI and the SSSE3 byte shuffle, which every CPU with AES-NI also has
+	static bool HaveAESNI()
 	{
-#if 0 //def _OPENMP
-		const int partitions=omp_get_num_threads();
-		const int thispartition=omp_get_thread_num();
+		static int have=-1;
+		if(have<0)
+		{
+#ifdef _MSC_VER
+			int regs[4];
+			__cpuid(regs, 1);
+			have=(regs[2]>>25)&(regs[2]>>9)&1;
 #else
-		const int partitions=1;
-		const int thispartition=0;
+			unsigned a, b, c, d;
+			have=__get_cpuid(1, &a, &b, &c, &d) ? (c>>25)&(c>>9)&1 : 0;
 #endif
-		const size_t thislength=(length/partitions)&~(sizeof(typename generator_type::result_type)-1);
-		const size_t thisno=thislength/sizeof(typename generator_type::result_type);
-		random_device rd;
-		generator_type gen(rd());
-		typename generator_type::result_type *tofill=(typename generator_type::result_type *) buffer;
-		if(thispartition)
-			tofill+=thisno*thispartition;
-		for(size_t n=0; n<thisno; n++)
-			*tofill++=gen();
-		if(thispartition==partitions-1)
+		}
+		return have!=0;
+	}
+
+#define AES128_EXPAND_STEP(n, rcon) rk[n]=AES128ExpandStep(rk[n-1], _mm_aeskeygenassist_si128(rk[n-1], rcon))
+	AESNI_TARGET static inline __m128i AES128ExpandStep(__m128i key, __m128i keygen)
+	{
+		keygen=_mm_shuffle_epi32(keygen, _MM_SHUFFLE(3, 3, 3, 3));
+		key=_mm_xor_si128(key, _mm_slli_si128(key, 4));
+		key=_mm_xor_si128(key, _mm_slli_si128(key, 4));
+		key=_mm_xor_si128(key, _mm_slli_si128(key, 4));
+		return _mm_xor_si128(key, keygen);
+	}
+	AESNI_TARGET static void AES128ExpandKey(__m128i *rk, const unsigned char *key)
+	{
+		rk[0]=_mm_loadu_si128((const __m128i *) key);
+		AES128_EXPAND_STEP(1, 0x01);
+		AES128_EXPAND_STEP(2, 0x02);
+		AES128_EXPAND_STEP(3, 0x04);
+		AES128_EXPAND_STEP(4, 0x08);
+		AES128_EXPAND_STEP(5, 0x10);
+		AES128_EXPAND_STEP(6, 0x20);
+		AES128_EXPAND_STEP(7, 0x40);
+		AES128_EXPAND_STEP(8, 0x80);
+		AES128_EXPAND_STEP(9, 0x1b);
+		AES128_EXPAND_STEP(10, 0x36);
+	}
+#undef AES128_EXPAND_STEP
+
+	class AESCTRDRBG
+	{
+		__m128i rk[11];
+		uint64_t vhi, vlo;	// V as a big endian 128 bit integer
+		size_t requests;
+		// Increments V and returns it in big endian byte order
+		__m128i int_nextCounter()
 		{
-			for(size_t remaining=length-(thislength*partitions); remaining>0; remaining-=sizeof(typename generator_type::result_type))
+			if(!++vlo) ++vhi;
+			union { uint64_t q[2]; __m128i v; } ret;
+			ret.q[0]=bswap_64(vhi);
+			ret.q[1]=bswap_64(vlo);
+			return ret.v;
+		}
+		// Writes blocks of keystream to out
+		AESNI_TARGET void int_keystream(char *out, size_t blocks)
+		{
+			// Counters are made in SSE registers as little endian {vlo, vhi} and byte reversed into big endian
+			const __m128i bswap=_mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), one=_mm_set_epi64x(0, 1);
+			for(; blocks>=8; blocks-=8, out+=128)
 			{
-				*tofill++=gen();
+				__m128i b0, b1, b2, b3, b4, b5, b6, b7;
+				if(vlo<=~(uint64_t) 0-8)
+				{
+					// No carry into vhi within these eight
+					__m128i c=_mm_set_epi64x((long long) vhi, (long long) vlo);
+					b0=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap); b1=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap);
+					b2=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap); b3=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap);
+					b4=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap); b5=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap);
+					b6=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap); b7=_mm_shuffle_epi8(c=_mm_add_epi64(c, one), bswap);
+					vlo+=8;
+				}
+				else
+				{
+					b0=int_nextCounter(); b1=int_nextCounter(); b2=int_nextCounter(); b3=int_nextCounter();
+					b4=int_nextCounter(); b5=int_nextCounter(); b6=int_nextCounter(); b7=int_nextCounter();
+				}
+				b0=_mm_xor_si128(b0, rk[0]); b1=_mm_xor_si128(b1, rk[0]); b2=_mm_xor_si128(b2, rk[0]); b3=_mm_xor_si128(b3, rk[0]);
+				b4=_mm_xor_si128(b4, rk[0]); b5=_mm_xor_si128(b5, rk[0]); b6=_mm_xor_si128(b6, rk[0]); b7=_mm_xor_si128(b7, rk[0]);
+				for(int r=1; r<10; r++)
+				{
+					b0=_mm_aesenc_si128(b0, rk[r]); b1=_mm_aesenc_si128(b1, rk[r]);
+					b2=_mm_aesenc_si128(b2, rk[r]); b3=_mm_aesenc_si128(b3, rk[r]);
+					b4=_mm_aesenc_si128(b4, rk[r]); b5=_mm_aesenc_si128(b5, rk[r]);
+					b6=_mm_aesenc_si128(b6, rk[r]); b7=_mm_aesenc_si128(b7, rk[r]);
+				}
+				_mm_storeu_si128((__m128i *) out, _mm_aesenclast_si128(b0, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+16), _mm_aesenclast_si128(b1, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+32), _mm_aesenclast_si128(b2, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+48), _mm_aesenclast_si128(b3, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+64), _mm_aesenclast_si128(b4, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+80), _mm_aesenclast_si128(b5, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+96), _mm_aesenclast_si128(b6, rk[10]));
+				_mm_storeu_si128((__m128i *)(out+112), _mm_aesenclast_si128(b7, rk[10]));
+			}
+			for(; blocks; blocks--, out+=16)
+			{
+				__m128i b=_mm_xor_si128(int_nextCounter(), rk[0]);
+				for(int r=1; r<10; r++)
+					b=_mm_aesenc_si128(b, rk[r]);
+				_mm_storeu_si128((__m128i *) out, _mm_aesenclast_si128(b, rk[10]));
+			}
+		}
+		// CTR_DRBG_Update() from SP 800-90A
+		void int_update(const unsigned char *data)
+		{
+			TYPEALIGNMENT(16) unsigned char temp[32];
+			int_keystream((char *) temp, 2);
+			if(data)
+			{
+				for(int n=0; n<32; n++)
+					temp[n]^=data[n];
+			}
+			AES128ExpandKey(rk, temp);
+			memcpy(&vhi, temp+16, 8);
+			memcpy(&vlo, temp+24, 8);
+			vhi=bswap_64(vhi);
+			vlo=bswap_64(vlo);
+			memset(temp, 0, sizeof(temp));
+		}
+	public:
+		static bool available() { return HaveAESNI(); }
+		//! Instantiates the generator from 32 bytes of \em entropy, or from fresh OS entropy if null
+		explicit AESCTRDRBG(const unsigned char *entropy=nullptr) : vhi(0), vlo(0), requests(0)
+		{
+			TYPEALIGNMENT(16) unsigned char zerokey[16]={0};
+			AES128ExpandKey(rk, zerokey);
+			if(entropy)
+				reseed(entropy);
+			else
+				reseed();
+		}
+		~AESCTRDRBG() { memset(rk, 0, sizeof(rk)); }
+		//! Reseeds the generator with 32 bytes of \em entropy
+		void reseed(const unsigned char *entropy)
+		{
+			int_update(entropy);
+			requests=0;
+		}
+		//! Reseeds the generator with fresh OS entropy
+		void reseed()
+		{
+			unsigned char seed[32];
+			OSEntropy(seed, sizeof(seed));
+			reseed(seed);
+			memset(seed, 0, sizeof(seed));
+		}
+		//! Fills out with length bytes of random data
+		void generate(char *out, size_t length)
+		{
+			while(length)
+			{
+				if(requests>=reseed_interval)
+					reseed();
+				size_t thislength=length<max_request ? length : max_request;
+				int_keystream(out, thislength/16);
+				if(thislength & 15)
+				{
+					TYPEALIGNMENT(16) char temp[16];
+					int_keystream(temp, 1);
+					memcpy(out+(thislength & ~(size_t) 15), temp, thislength & 15);
+					memset(temp, 0, sizeof(temp));
+				}
+				int_update(nullptr);
+				requests++;
+				out+=thislength;
+				length-=thislength;
 			}
 		}
+	};
+#endif
+
+	class ChaCha20DRBG
+	{
+		uint32_t key[8];
+		size_t requests;
+		static uint32_t rotl(uint32_t v, int n) { return (v<<n)|(v>>(32-n)); }
+		static void quarterround(uint32_t *x, int a, int b, int c, int d)
+		{
+			x[a]+=x[b]; x[d]=rotl(x[d]^x[a], 16);
+			x[c]+=x[d]; x[b]=rotl(x[b]^x[c], 12);
+			x[a]+=x[b]; x[d]=rotl(x[d]^x[a], 8);
+			x[c]+=x[d]; x[b]=rotl(x[b]^x[c], 7);
+		}
+		void int_block(uint32_t *out, uint64_t ctr) const { block(out, key, ctr); }
+	public:
+		//! Writes the 64 byte keystream block for \em key and counter \em ctr with a zero nonce to \em out
+		static void block(uint32_t *out, const uint32_t *key, uint64_t ctr)
+		{
+			uint32_t x[16]={0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+				key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+				(uint32_t) ctr, (uint32_t)(ctr>>32), 0, 0};
+			uint32_t in[16];
+			memcpy(in, x, sizeof(in));
+			for(int n=0; n<10; n++)
+			{
+				quarterround(x, 0, 4, 8, 12); quarterround(x, 1, 5, 9, 13);
+				quarterround(x, 2, 6, 10, 14); quarterround(x, 3, 7, 11, 15);
+				quarterround(x, 0, 5, 10, 15); quarterround(x, 1, 6, 11, 12);
+				quarterround(x, 2, 7, 8, 13); quarterround(x, 3, 4, 9, 14);
+			}
+			for(int n=0; n<16; n++)
+				out[n]=x[n]+in[n];
+		}
+		ChaCha20DRBG() { reseed(); }
+		~ChaCha20DRBG() { memset(key, 0, sizeof(key)); }
+		//! Reseeds the generator with fresh OS entropy
+		void reseed()
+		{
+			OSEntropy(key, sizeof(key));
+			requests=0;
+		}
+		//! Fills out with length bytes of random data
+		void generate(char *out, size_t length)
+		{
+			uint32_t block[16];
+			while(length)
+			{
+				if(requests>=reseed_interval)
+					reseed();
+				size_t thislength=length<max_request ? length : max_request;
+				// Block zero replaces the key, the rest is output
+				int_block(block, 0);
+				uint64_t ctr=1;
+				for(size_t n=0; n<thislength; n+=64, ctr++)
+				{
+					uint32_t out32[16];
+					int_block(out32, ctr);
+					memcpy(out+n, out32, (thislength-n<64) ? thislength-n : 64);
+				}
+				memcpy(key, block, sizeof(key));
+				requests++;
+				out+=thislength;
+				length-=thislength;
+			}
+			memset(block, 0, sizeof(block));
+		}
+	};
+}
+
+void Impl::quality_random_chacha20(char *out, size_t length, const unsigned char *key, unsigned long long ctr)
+{
+	uint32_t k[8], block[16];
+	memcpy(k, key, sizeof(k));
+	for(; length; ctr++)
+	{
+		size_t thislength=length<64 ? length : 64;
+		QualityRandom::ChaCha20DRBG::block(block, k, ctr);
+		memcpy(out, block, thislength);
+		out+=thislength;
+		length-=thislength;
 	}
 }
 
-void Int128::FillFastRandom(Int128 *ints, size_t no)
+bool Impl::quality_random_ctr_drbg(char *out, size_t length, const unsigned char *entropy)
 {
-	size_t length=no*sizeof(*ints);
-	if(no && no!=length/sizeof(*ints)) abort();
-#if HAVE_M128 || HAVE_NEON128
-	// The Mersenne Twister's SIMD implementation beats all else
-#ifdef __LP64__
-	typedef mt19937_64 generator_type;
+#if HAVE_AESNI_INTRINSICS
+	if(!QualityRandom::AESCTRDRBG::available())
+		return false;
+	QualityRandom::AESCTRDRBG gen(entropy);
+	gen.generate(out, length);
+	gen.generate(out, length);
+	return true;
 #else
-	typedef mt19937 generator_type;
+	(void) out; (void) length; (void) entropy;
+	return false;
 #endif
+}
+
+/* Each thread lazily seeds its own generators on first use and keeps them for all subsequent calls, so
+getting a single random value costs tens of cycles rather than an OS entropy read plus generator setup. A
+fork()ed child would repeat its parent's output, so the child bumps forkgeneration which makes every
+generator reseed on its next use. Everything is set up on first use rather than by static initialisers, so
+random numbers can be had during the static initialisation of other translation units.
+*/
+namespace ThreadRandom
+{
+	static std::atomic<unsigned> forkgeneration(1);	// So zero initialised thread state is always stale
+#ifndef WIN32
+	static void OnFork() { forkgeneration.fetch_add(1, std::memory_order_relaxed); }
+#endif
+	// Returns the fork generation, first registering the fork handler so it precedes any state it makes stale
+	static unsigned ForkGeneration()
+	{
+#ifndef WIN32
+		static const bool registered=(pthread_atfork(nullptr, nullptr, OnFork), true);
+		(void) registered;
+#endif
+		// Not forkgeneration.load() as the SSE SHA-256 defines a load macro
+		return std::atomic_load_explicit(&forkgeneration, std::memory_order_relaxed);
+	}
+
+	// Thread's position in its own Philox stream
+	struct FastState
+	{
+		unsigned long long seed, ctr;
+		unsigned int generation;
+	};
+	static THREADLOCALPOD FastState faststate;
+	// Reserves no consecutive blocks of this thread's Philox stream, returning the first counter
+	static unsigned long long ReserveFast(unsigned long long &seed, unsigned long long no)
+	{
+		FastState &s=faststate;
+		unsigned generation=ForkGeneration();
+		if(s.generation!=generation || s.ctr+no<s.ctr)
+		{
+			OSEntropy(&s.seed, sizeof(s.seed));
+			s.ctr=0;
+			s.generation=generation;
+		}
+		seed=s.seed;
+		unsigned long long ret=s.ctr;
+		s.ctr+=no;
+		return ret;
+	}
+
+	struct QualityGenerator
+	{
+		unsigned int generation;
+		QualityGenerator() : generation(ForkGeneration()) { }
+		virtual ~QualityGenerator() { }
+		virtual void reseed()=0;
+		virtual void generate(char *out, size_t length)=0;
+	};
+	template<class generator_type> struct QualityGeneratorImpl : public QualityGenerator
+	{
+		generator_type gen;
+		virtual void reseed() { gen.reseed(); }
+		virtual void generate(char *out, size_t length) { gen.generate(out, length); }
+	};
+	static void DeleteQualityGenerator(void *p)
+	{
+		QualityGenerator *g=(QualityGenerator *) p;
+		g->~QualityGenerator();
+		detail::deallocate_aligned_memory(g);
+	}
+	template<class generator_type> static QualityGenerator *MakeQualityGenerator()
+	{
+		void *mem=detail::allocate_aligned_memory(16, sizeof(QualityGeneratorImpl<generator_type>));
+		if(!mem) throw std::bad_alloc();
+		return new(mem) QualityGeneratorImpl<generator_type>;
+	}
+
+	// The thread's quality generator is owned by a TLS key whose destructor deletes it at thread exit
+#ifdef WIN32
+	static VOID WINAPI FlsDeleteQualityGenerator(PVOID p) { if(p) DeleteQualityGenerator(p); }
+	static DWORD quality_key()
+	{
+		static const DWORD key=FlsAlloc(FlsDeleteQualityGenerator);
+		return key;
+	}
+	static void SetQualityOwner(QualityGenerator *g) { FlsSetValue(quality_key(), g); }
 #else
-#ifdef __LP64__
-	typedef ranlux48_base generator_type;
-#else
-	typedef ranlux24_base generator_type;
+	static pthread_key_t quality_key()
+	{
+		static struct Init
+		{
+			pthread_key_t key;
+			Init() { pthread_key_create(&key, DeleteQualityGenerator); }
+		} init;
+		return init.key;
+	}
+	static void SetQualityOwner(QualityGenerator *g) { pthread_setspecific(quality_key(), g); }
 #endif
+	static THREADLOCALPOD QualityGenerator *qualitygenerator;
+	// Returns this thread's quality generator, making it if necessary
+	static QualityGenerator *Quality()
+	{
+		QualityGenerator *g=qualitygenerator;
+		if(!g)
+		{
+#if HAVE_AESNI_INTRINSICS
+			if(QualityRandom::AESCTRDRBG::available())
+				g=MakeQualityGenerator<QualityRandom::AESCTRDRBG>();
+			else
 #endif
-	FillRandom<generator_type>((char *) ints, length);
+				g=MakeQualityGenerator<QualityRandom::ChaCha20DRBG>();
+			SetQualityOwner(g);
+			qualitygenerator=g;
+		}
+		else
+		{
+			unsigned generation=ForkGeneration();
+			if(g->generation!=generation)
+			{
+				g->reseed();
+				g->generation=generation;
+			}
+		}
+		return g;
+	}
+}
+
+void Int128::FillFastRandom(Int128 *ints, size_t no)
+{
+	unsigned long long seed, ctr=ThreadRandom::ReserveFast(seed, no);
+	Philox::ParallelFill((uint32_t *) ints, no, ctr, seed);
+}
+
+void Int128::FillFastRandom(Int128 *ints, size_t no, unsigned long long seed, unsigned long long offset)
+{
+	size_t length=no*sizeof(*ints);
+	if(no && no!=length/sizeof(*ints)) abort();
+	Philox::ParallelFill((uint32_t *) ints, no, offset, seed);
+}
+
+/* Bulk fills give each OpenMP thread its own request sized pieces to fill from that thread's generator.
+Below a megabyte the thread dispatch costs more than it saves.
+*/
+static void FillQuality(char *buffer, size_t length)
+{
+	if(length<(1<<20))
+	{
+		ThreadRandom::Quality()->generate(buffer, length);
+		return;
+	}
+	const size_t max_request=QualityRandom::max_request;
+	const ptrdiff_t requests=(ptrdiff_t)((length+max_request-1)/max_request);
+#pragma omp parallel
+	{
+		ThreadRandom::QualityGenerator *gen=ThreadRandom::Quality();
+#pragma omp for schedule(static)
+		for(ptrdiff_t n=0; n<requests; n++)
+		{
+			size_t offset=n*max_request, thislength=length-offset;
+			if(thislength>max_request) thislength=max_request;
+			gen->generate(buffer+offset, thislength);
+		}
+	}
 }
 
 void Int128::FillQualityRandom(Int128 *ints, size_t no)
 {
 	size_t length=no*sizeof(*ints);
 	if(no && no!=length/sizeof(*ints)) abort();
-#ifdef __LP64__
-	typedef mt19937_64 generator_type;
-#else
-	typedef mt19937 generator_type;
-#endif
-	FillRandom<generator_type>((char *) ints, length);
+	FillQuality((char *) ints, length);
 }
 
 void Int256::FillFastRandom(Int256 *ints, size_t no)
+{
+	unsigned long long seed, ctr=ThreadRandom::ReserveFast(seed, 2*(unsigned long long) no);
+	Philox::ParallelFill((uint32_t *) ints, 2*no, ctr, seed);
+}
+
+void Int256::FillFastRandom(Int256 *ints, size_t no, unsigned long long seed, unsigned long long offset)
 {
 	size_t length=no*sizeof(*ints);
 	if(no && no!=length/sizeof(*ints)) abort();
-#if HAVE_M128 || HAVE_NEON128
-	// The Mersenne Twister's SIMD implementation beats all else
-#ifdef __LP64__
-	typedef mt19937_64 generator_type;
-#else
-	typedef mt19937 generator_type;
-#endif
-#else
-#ifdef __LP64__
-	typedef ranlux48_base generator_type;
-#else
-	typedef ranlux24_base generator_type;
-#endif
-#endif
-	FillRandom<generator_type>((char *) ints, length);
+	// Each Int256 is two consecutive blocks, so the byte stream is identical to that of Int128
+	Philox::ParallelFill((uint32_t *) ints, 2*no, 2*offset, seed);
 }
 
 void Int256::FillQualityRandom(Int256 *ints, size_t no)
 {
 	size_t length=no*sizeof(*ints);
 	if(no && no!=length/sizeof(*ints)) abort();
-#ifdef __LP64__
-	typedef mt19937_64 generator_type;
-#else
-	typedef mt19937 generator_type;
-#endif
-	FillRandom<generator_type>((char *) ints, length);
+	FillQuality((char *) ints, length);
 }
 
 void Hash128::AddFastHashTo(const char *data, size_t length)
@@ -317,8 +891,8 @@ void Hash256::AddSHA256ToBatch(BatchHashOp _h, size_t no, const BatchItem *datas
 			}
 		}
 		// We know from benchmarking that the above can push 3.5 streams in the time of a single stream,
-		// so keep going if there are at least two streams remaining
-	} while(inuse>1);
+		// so keep going if there are at least two streams remaining or more items to feed in
+	} while(inuse>1 || no);
 	if(inuse)
 	{
 		for(size_t n=0; n<4; n++)
@@ -373,7 +947,8 @@ static void _FinishBatch(HashOp *h)
 #endif
 						inuse=0;
 					}
-					h->scratch[n].pos=0;
+					// Mark the 0x80 as written so the final round is only the length
+					h->scratch[n].pos=sizeof(__sha256_block_t);
 				}
 			}
 			if(inuse)
@@ -402,8 +977,13 @@ static void _FinishBatch(HashOp *h)
 				});
 				termination_t *termination=(termination_t *) h->scratch[n].d;
 				static_assert(sizeof(*termination)==64, "termination_t is not sized exactly 64 bytes!");
-				memset(termination->data+h->scratch[n].pos, 0, sizeof(__sha256_block_t)-h->scratch[n].pos);
-				termination->data[h->scratch[n].pos]=(unsigned char) 0x80;
+				if(h->scratch[n].pos==sizeof(__sha256_block_t))
+					memset(termination->data, 0, sizeof(termination->data));
+				else
+				{
+					memset(termination->data+h->scratch[n].pos, 0, sizeof(__sha256_block_t)-h->scratch[n].pos);
+					termination->data[h->scratch[n].pos]=(unsigned char) 0x80;
+				}
 				termination->length=bswap_64(8*h->scratch[n].length);
 				blks[inuse]=(const __sha256_block_t *) h->scratch[n].d;
 				out[inuse]=(__sha256_hash_t *) h->hashs[n].asInts();
@@ -435,9 +1015,10 @@ static void _FinishBatch(HashOp *h)
 #endif
 				inuse=0;
 			}
-			// As we're little endian flip back the words
+			// As we're little endian flip back the words, and empty the scratch for reuse
 			for(size_t n=0; n<h->no; n++)
 			{
+				h->scratch[n].pos=0;
 				for(int m=0; m<8; m++)
 					*const_cast<unsigned int *>(h->hashs[n].asInts()+m)=LOAD_BIG_32(h->hashs[n].asInts()+m);
 			}
@@ -13,9 +13,14 @@ AVX2 accelerated 256 bit integer implementation. Falls back to SSE2/NEON 128 bit
 */
 
 #include "NiallsCPP11Utilities.hpp"
+#include "PoolAllocator.hpp"
 #include <cstring>
 #include <exception>
 #include <string>
+#include <deque>
+#include <forward_list>
+#include <set>
+#include <unordered_set>
 
 /*! \def HAVE_M256
 \brief Turns on support for the __m256i hardware accelerated type
@@ -86,10 +91,34 @@ inline unsigned _mm_movemask_epi8_neon(uint32x4_t Input)
 
 namespace NiallsCPP11Utilities {
 
+namespace Impl {
+	//! Returns the number of bits set in \em v
+	inline unsigned popcount64(unsigned long long v)
+	{
+#if defined(__GNUC__) && defined(__POPCNT__)
+		return (unsigned) __builtin_popcountll(v);
+#else
+		v=v-((v>>1)&0x5555555555555555ULL);
+		v=(v&0x3333333333333333ULL)+((v>>2)&0x3333333333333333ULL);
+		v=(v+(v>>4))&0x0f0f0f0f0f0f0f0fULL;
+		return (unsigned)((v*0x0101010101010101ULL)>>56);
+#endif
+	}
+	//! Writes \em length bytes of the ChaCha20 keystream used by FillQualityRandom() for the 32 byte \em key with a zero nonce, from block \em ctr onwards
+	extern NIALLSCPP11UTILITIES_API void quality_random_chacha20(char *out, size_t length, const unsigned char *key, unsigned long long ctr);
+	/*! \brief Instantiates the AES-128 CTR_DRBG used by FillQualityRandom() from 32 bytes of \em entropy, generates
+	\em length bytes twice and writes the second to \em out, as do NIST's SP 800-90A no derivation function known
+	answer tests. Returns false if the CPU lacks AES-NI.
+	*/
+	extern NIALLSCPP11UTILITIES_API bool quality_random_ctr_drbg(char *out, size_t length, const unsigned char *entropy);
+}
+
 /*! \class Int128
 \brief Declares a 128 bit SSE2/NEON compliant container. WILL throw exception if initialised unaligned.
 
-Implemented as a __m128i or NEON uint32x4_t if available, otherwise as long longs.
+Implemented as a __m128i or NEON uint32x4_t if available, otherwise as long longs. The standard containers of
+this type and of Hash128 with the default std::allocator, including maps and unordered maps keyed by them, are
+specialised to allocate aligned storage instead, a vector from aligned_allocator and the others from pool_allocator.
 */
 class NIALLSCPP11UTILITIES_API TYPEALIGNMENT(16) Int128
 {
@@ -160,6 +189,62 @@ public:
 	bool operator<(const Int128 &o) const { return o>*this; }
 	bool operator>=(const Int128 &o) const { return !(o>*this); }
 	bool operator<=(const Int128 &o) const { return !(*this>o); }
+	//! Bitwise ANDs with another int
+	Int128 &operator&=(const Int128 &o)
+	{
+#if HAVE_M128
+		mydata.asM128=_mm_and_si128(mydata.asM128, o.mydata.asM128);
+#elif HAVE_NEON128
+		mydata.asNEON=vandq_u32(mydata.asNEON, o.mydata.asNEON);
+#else
+		mydata.asLongLongs[0]&=o.mydata.asLongLongs[0]; mydata.asLongLongs[1]&=o.mydata.asLongLongs[1];
+#endif
+		return *this;
+	}
+	//! Bitwise ORs with another int
+	Int128 &operator|=(const Int128 &o)
+	{
+#if HAVE_M128
+		mydata.asM128=_mm_or_si128(mydata.asM128, o.mydata.asM128);
+#elif HAVE_NEON128
+		mydata.asNEON=vorrq_u32(mydata.asNEON, o.mydata.asNEON);
+#else
+		mydata.asLongLongs[0]|=o.mydata.asLongLongs[0]; mydata.asLongLongs[1]|=o.mydata.asLongLongs[1];
+#endif
+		return *this;
+	}
+	//! Bitwise XORs with another int
+	Int128 &operator^=(const Int128 &o)
+	{
+#if HAVE_M128
+		mydata.asM128=_mm_xor_si128(mydata.asM128, o.mydata.asM128);
+#elif HAVE_NEON128
+		mydata.asNEON=veorq_u32(mydata.asNEON, o.mydata.asNEON);
+#else
+		mydata.asLongLongs[0]^=o.mydata.asLongLongs[0]; mydata.asLongLongs[1]^=o.mydata.asLongLongs[1];
+#endif
+		return *this;
+	}
+	//! Clears the bits which are set in another int i.e. *this&=~o
+	Int128 &andNot(const Int128 &o)
+	{
+#if HAVE_M128
+		mydata.asM128=_mm_andnot_si128(o.mydata.asM128, mydata.asM128);
+#elif HAVE_NEON128
+		mydata.asNEON=vbicq_u32(mydata.asNEON, o.mydata.asNEON);
+#else
+		mydata.asLongLongs[0]&=~o.mydata.asLongLongs[0]; mydata.asLongLongs[1]&=~o.mydata.asLongLongs[1];
+#endif
+		return *this;
+	}
+	Int128 operator&(const Int128 &o) const { Int128 ret(*this); ret&=o; return ret; }
+	Int128 operator|(const Int128 &o) const { Int128 ret(*this); ret|=o; return ret; }
+	Int128 operator^(const Int128 &o) const { Int128 ret(*this); ret^=o; return ret; }
+	Int128 operator~() const { Int128 ret; ret.mydata.asLongLongs[0]=~mydata.asLongLongs[0]; ret.mydata.asLongLongs[1]=~mydata.asLongLongs[1]; return ret; }
+	//! True if no bits are set
+	bool isZero() const { return !(mydata.asLongLongs[0]|mydata.asLongLongs[1]); }
+	//! Returns the number of bits set
+	unsigned popCount() const { return Impl::popcount64(mydata.asLongLongs[0])+Impl::popcount64(mydata.asLongLongs[1]); }
 	//! Returns the int as bytes
 	const char *asBytes() const { return mydata.asBytes; }
 	//! Returns the int as ints
@@ -182,22 +267,30 @@ public:
 	}
 	/*! \brief Fast gets \em no random Int128s.
 
-	Intel Ivy Bridge: Performance on 32 bit is approx. 2.95 cycles/byte. Performance on 64 bit is approx. 1.52 cycles/byte.
-
-	Intel Atom: Performance on 32 bit is approx. 9.38 cycles/byte. 
-	
-	ARM Cortex-A15: Performance on 32 bit is approx. 26.17 cycles/byte.
+	Uses the Philox4x32-10 counter based generator. As every 128 bit block of output is a pure function of the
+	seed and its position, large fills are split across all OpenMP threads and the SSE2/AVX2 implementations
+	generate four/eight blocks at once. Each thread lazily seeds its own stream from the OS on first use and
+	reseeds after fork(), so a single value costs tens of cycles.
 	*/
 	static void FillFastRandom(Int128 *ints, size_t no);
+	/*! \brief Fast gets \em no random Int128s reproducibly from \em seed.
+
+	The output is identical to positions \em offset onwards of the stream for \em seed, so any thread can
+	generate any portion of the stream independently. Int128 and Int256 share the same byte stream.
+	*/
+	static void FillFastRandom(Int128 *ints, size_t no, unsigned long long seed, unsigned long long offset=0);
 	//! Fast fills a vector with random Int128s
 	static inline void FillFastRandom(std::vector<Int128> &ints);
+	//! Fast fills a vector with random Int128s reproducibly from \em seed
+	static inline void FillFastRandom(std::vector<Int128> &ints, unsigned long long seed, unsigned long long offset=0);
 	/*! \brief Quality gets \em no random Int128s.
 
-	Intel Ivy Bridge: Performance on 32 bit is approx. 2.95 cycles/byte. Performance on 64 bit is approx. 1.52 cycles/byte.
+	Uses the AES-128 CTR_DRBG of NIST SP 800-90A when the CPU has AES-NI, otherwise a ChaCha20 generator.
+	Both are seeded from the OS (getrandom() on Linux, else std::random_device), rekey after every 64Kb
+	request and reseed every 4Gb. Each thread keeps its own generator, which reseeds after fork(). Fills of a
+	megabyte or more are split across OpenMP threads.
 
-	Intel Atom: Performance on 32 bit is approx. 9.38 cycles/byte. 
-	
-	ARM Cortex-A15: Performance on 32 bit is approx. 26.84 cycles/byte.
+	Intel Xeon virtual machine with AES-NI: Performance on 64 bit is approx. 0.4 cycles/byte.
 	*/
 	static void FillQualityRandom(Int128 *ints, size_t no);
 	//! Quality fills a vector with random Int128s
@@ -208,6 +301,8 @@ public:
 \brief Declares a 256 bit AVX2/SSE2/NEON compliant container. WILL throw exception if initialised unaligned.
 
 Implemented as a __m256i if available (AVX2), otherwise two __m128i's or two NEON uint32x4_t's if available, otherwise as many long longs.
+As with Int128, the standard containers of this type and of Hash256 with the default std::allocator are specialised
+to allocate aligned storage instead.
 */
 class NIALLSCPP11UTILITIES_API TYPEALIGNMENT(32) Int256
 {
@@ -294,6 +389,77 @@ public:
 	bool operator<(const Int256 &o) const { return o>*this; }
 	bool operator>=(const Int256 &o) const { return !(o>*this); }
 	bool operator<=(const Int256 &o) const { return !(*this>o); }
+	//! Bitwise ANDs with another int
+	Int256 &operator&=(const Int256 &o)
+	{
+#if HAVE_M256
+		mydata.asM256=_mm256_and_si256(mydata.asM256, o.mydata.asM256);
+#elif HAVE_M128
+		mydata.asM128s[0]=_mm_and_si128(mydata.asM128s[0], o.mydata.asM128s[0]); mydata.asM128s[1]=_mm_and_si128(mydata.asM128s[1], o.mydata.asM128s[1]);
+#elif HAVE_NEON128
+		mydata.asNEONs[0]=vandq_u32(mydata.asNEONs[0], o.mydata.asNEONs[0]); mydata.asNEONs[1]=vandq_u32(mydata.asNEONs[1], o.mydata.asNEONs[1]);
+#else
+		for(int n=0; n<4; n++) mydata.asLongLongs[n]&=o.mydata.asLongLongs[n];
+#endif
+		return *this;
+	}
+	//! Bitwise ORs with another int
+	Int256 &operator|=(const Int256 &o)
+	{
+#if HAVE_M256
+		mydata.asM256=_mm256_or_si256(mydata.asM256, o.mydata.asM256);
+#elif HAVE_M128
+		mydata.asM128s[0]=_mm_or_si128(mydata.asM128s[0], o.mydata.asM128s[0]); mydata.asM128s[1]=_mm_or_si128(mydata.asM128s[1], o.mydata.asM128s[1]);
+#elif HAVE_NEON128
+		mydata.asNEONs[0]=vorrq_u32(mydata.asNEONs[0], o.mydata.asNEONs[0]); mydata.asNEONs[1]=vorrq_u32(mydata.asNEONs[1], o.mydata.asNEONs[1]);
+#else
+		for(int n=0; n<4; n++) mydata.asLongLongs[n]|=o.mydata.asLongLongs[n];
+#endif
+		return *this;
+	}
+	//! Bitwise XORs with another int
+	Int256 &operator^=(const Int256 &o)
+	{
+#if HAVE_M256
+		mydata.asM256=_mm256_xor_si256(mydata.asM256, o.mydata.asM256);
+#elif HAVE_M128
+		mydata.asM128s[0]=_mm_xor_si128(mydata.asM128s[0], o.mydata.asM128s[0]); mydata.asM128s[1]=_mm_xor_si128(mydata.asM128s[1], o.mydata.asM128s[1]);
+#elif HAVE_NEON128
+		mydata.asNEONs[0]=veorq_u32(mydata.asNEONs[0], o.mydata.asNEONs[0]); mydata.asNEONs[1]=veorq_u32(mydata.asNEONs[1], o.mydata.asNEONs[1]);
+#else
+		for(int n=0; n<4; n++) mydata.asLongLongs[n]^=o.mydata.asLongLongs[n];
+#endif
+		return *this;
+	}
+	//! Clears the bits which are set in another int i.e. *this&=~o
+	Int256 &andNot(const Int256 &o)
+	{
+#if HAVE_M256
+		mydata.asM256=_mm256_andnot_si256(o.mydata.asM256, mydata.asM256);
+#elif HAVE_M128
+		mydata.asM128s[0]=_mm_andnot_si128(o.mydata.asM128s[0], mydata.asM128s[0]); mydata.asM128s[1]=_mm_andnot_si128(o.mydata.asM128s[1], mydata.asM128s[1]);
+#elif HAVE_NEON128
+		mydata.asNEONs[0]=vbicq_u32(mydata.asNEONs[0], o.mydata.asNEONs[0]); mydata.asNEONs[1]=vbicq_u32(mydata.asNEONs[1], o.mydata.asNEONs[1]);
+#else
+		for(int n=0; n<4; n++) mydata.asLongLongs[n]&=~o.mydata.asLongLongs[n];
+#endif
+		return *this;
+	}
+	Int256 operator&(const Int256 &o) const { Int256 ret(*this); ret&=o; return ret; }
+	Int256 operator|(const Int256 &o) const { Int256 ret(*this); ret|=o; return ret; }
+	Int256 operator^(const Int256 &o) const { Int256 ret(*this); ret^=o; return ret; }
+	Int256 operator~() const { Int256 ret; for(int n=0; n<4; n++) ret.mydata.asLongLongs[n]=~mydata.asLongLongs[n]; return ret; }
+	//! True if no bits are set
+	bool isZero() const
+	{
+#if HAVE_M256
+		return 0!=_mm256_testz_si256(mydata.asM256, mydata.asM256);
+#else
+		return !(mydata.asLongLongs[0]|mydata.asLongLongs[1]|mydata.asLongLongs[2]|mydata.asLongLongs[3]);
+#endif
+	}
+	//! Returns the number of bits set
+	unsigned popCount() const { return Impl::popcount64(mydata.asLongLongs[0])+Impl::popcount64(mydata.asLongLongs[1])+Impl::popcount64(mydata.asLongLongs[2])+Impl::popcount64(mydata.asLongLongs[3]); }
 	//! Returns the int as bytes
 	const char *asBytes() const { return mydata.asBytes; }
 	//! Returns the int as ints
@@ -316,28 +482,133 @@ public:
 	}
 	/*! \brief Fast gets \em no random Int256s.
 
-	Intel Ivy Bridge: Performance on 32 bit is approx. 2.95 cycles/byte. Performance on 64 bit is approx. 1.52 cycles/byte.
-
-	Intel Atom: Performance on 32 bit is approx. 9.38 cycles/byte. 
-	
-	ARM Cortex-A15: Performance on 32 bit is approx. 16.63 cycles/byte.
+	Uses the Philox4x32-10 counter based generator. As every 128 bit block of output is a pure function of the
+	seed and its position, large fills are split across all OpenMP threads and the SSE2/AVX2 implementations
+	generate four/eight blocks at once. Each thread lazily seeds its own stream from the OS on first use and
+	reseeds after fork(), so a single value costs tens of cycles.
 	*/
 	static void FillFastRandom(Int256 *ints, size_t no);
+	/*! \brief Fast gets \em no random Int256s reproducibly from \em seed.
+
+	The output is identical to positions \em offset onwards of the stream for \em seed, so any thread can
+	generate any portion of the stream independently. Int128 and Int256 share the same byte stream.
+	*/
+	static void FillFastRandom(Int256 *ints, size_t no, unsigned long long seed, unsigned long long offset=0);
 	//! Fast fills a vector with random Int256s.
 	static inline void FillFastRandom(std::vector<Int256> &ints);
+	//! Fast fills a vector with random Int256s reproducibly from \em seed
+	static inline void FillFastRandom(std::vector<Int256> &ints, unsigned long long seed, unsigned long long offset=0);
 	/*! \brief Quality gets \em no random Int256s.
 
-	Intel Ivy Bridge: Performance on 32 bit is approx. 2.95 cycles/byte. Performance on 64 bit is approx. 1.52 cycles/byte.
+	Uses the AES-128 CTR_DRBG of NIST SP 800-90A when the CPU has AES-NI, otherwise a ChaCha20 generator.
+	Both are seeded from the OS (getrandom() on Linux, else std::random_device), rekey after every 64Kb
+	request and reseed every 4Gb. Each thread keeps its own generator, which reseeds after fork(). Fills of a
+	megabyte or more are split across OpenMP threads.
 
-	Intel Atom: Performance on 32 bit is approx. 9.38 cycles/byte. 
-	
-	ARM Cortex-A15: Performance on 32 bit is approx. 16.47 cycles/byte.
+	Intel Xeon virtual machine with AES-NI: Performance on 64 bit is approx. 0.4 cycles/byte.
 	*/
 	static void FillQualityRandom(Int256 *ints, size_t no);
 	//! Quality fills a vector with random Int256s.
 	static inline void FillQualityRandom(std::vector<Int256> &ints);
 };
 
+/*! \class Int128Ref
+\brief A read only view of 16 bytes at any alignment which compares and hashes like an Int128.
+
+Lets digests embedded in packed records, network frames or mapped files be compared and looked up without first
+copying them into an aligned Int128. An Int128 converts implicitly into a view of itself, so views and Int128s can
+be freely mixed in comparisons. As with any view, the bytes referenced must outlive it.
+*/
+class Int128Ref
+{
+	const char *mydata;
+public:
+	//! Constructs a view of the 16 bytes at \em bytes, which may have any alignment
+	explicit Int128Ref(const char *bytes) : mydata(bytes) { }
+	//! Constructs a view of an Int128
+	Int128Ref(const Int128 &o) : mydata(o.asBytes()) { }
+	friend bool operator==(const Int128Ref &a, const Int128Ref &b)
+	{
+#if HAVE_M128
+		__m128i result=_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) a.mydata), _mm_loadu_si128((const __m128i *) b.mydata));
+		unsigned r=_mm_movemask_epi8(result);
+		return r==0xffff;
+#elif HAVE_NEON128
+		uint32x4_t result=vceqq_u32(vld1q_u32((const uint32_t *) a.mydata), vld1q_u32((const uint32_t *) b.mydata));
+		unsigned r=_mm_movemask_epi8_neon(result);
+		return r==0xffff;
+#else
+		return !memcmp(a.mydata, b.mydata, 16);
+#endif
+	}
+	friend bool operator!=(const Int128Ref &a, const Int128Ref &b) { return !(a==b); }
+	friend bool operator>(const Int128Ref &a, const Int128Ref &b) { return memcmp(a.mydata, b.mydata, 16)>0; }
+	friend bool operator<(const Int128Ref &a, const Int128Ref &b) { return b>a; }
+	friend bool operator>=(const Int128Ref &a, const Int128Ref &b) { return !(b>a); }
+	friend bool operator<=(const Int128Ref &a, const Int128Ref &b) { return !(a>b); }
+	//! Returns the bytes viewed
+	const char *asBytes() const { return mydata; }
+	//! Returns the front of the int as a size_t
+	size_t asSize_t() const { size_t ret; memcpy(&ret, mydata, sizeof(ret)); return ret; }
+	//! Returns an aligned copy of the int
+	Int128 value() const { return Int128(mydata); }
+	//! Returns the int as a 32 character hexadecimal string
+	std::string asHexString() const { return value().asHexString(); }
+};
+
+/*! \class Int256Ref
+\brief A read only view of 32 bytes at any alignment which compares and hashes like an Int256.
+
+Lets digests embedded in packed records, network frames or mapped files be compared and looked up without first
+copying them into an aligned Int256. An Int256 converts implicitly into a view of itself, so views and Int256s can
+be freely mixed in comparisons. As with any view, the bytes referenced must outlive it.
+*/
+class Int256Ref
+{
+	const char *mydata;
+public:
+	//! Constructs a view of the 32 bytes at \em bytes, which may have any alignment
+	explicit Int256Ref(const char *bytes) : mydata(bytes) { }
+	//! Constructs a view of an Int256
+	Int256Ref(const Int256 &o) : mydata(o.asBytes()) { }
+	friend bool operator==(const Int256Ref &a, const Int256Ref &b)
+	{
+#if HAVE_M256
+		__m256i result=_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) a.mydata), _mm256_loadu_si256((const __m256i *) b.mydata));
+		return !(~_mm256_movemask_epi8(result));
+#elif HAVE_M128
+		__m128i result[2];
+		result[0]=_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) a.mydata), _mm_loadu_si128((const __m128i *) b.mydata));
+		result[1]=_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(a.mydata+16)), _mm_loadu_si128((const __m128i *)(b.mydata+16)));
+		unsigned r=_mm_movemask_epi8(result[0]);
+		r|=_mm_movemask_epi8(result[1])<<16;
+		return !(~r);
+#elif HAVE_NEON128
+		uint32x4_t result[2];
+		result[0]=vceqq_u32(vld1q_u32((const uint32_t *) a.mydata), vld1q_u32((const uint32_t *) b.mydata));
+		result[1]=vceqq_u32(vld1q_u32((const uint32_t *)(a.mydata+16)), vld1q_u32((const uint32_t *)(b.mydata+16)));
+		unsigned r=_mm_movemask_epi8_neon(result[0]);
+		r|=_mm_movemask_epi8_neon(result[1])<<16;
+		return !(~r);
+#else
+		return !memcmp(a.mydata, b.mydata, 32);
+#endif
+	}
+	friend bool operator!=(const Int256Ref &a, const Int256Ref &b) { return !(a==b); }
+	friend bool operator>(const Int256Ref &a, const Int256Ref &b) { return memcmp(a.mydata, b.mydata, 32)>0; }
+	friend bool operator<(const Int256Ref &a, const Int256Ref &b) { return b>a; }
+	friend bool operator>=(const Int256Ref &a, const Int256Ref &b) { return !(b>a); }
+	friend bool operator<=(const Int256Ref &a, const Int256Ref &b) { return !(a>b); }
+	//! Returns the bytes viewed
+	const char *asBytes() const { return mydata; }
+	//! Returns the front of the int as a size_t
+	size_t asSize_t() const { size_t ret; memcpy(&ret, mydata, sizeof(ret)); return ret; }
+	//! Returns an aligned copy of the int
+	Int256 value() const { return Int256(mydata); }
+	//! Returns the int as a 64 character hexadecimal string
+	std::string asHexString() const { return value().asHexString(); }
+};
+
 /*! \class Hash128
 \brief Provides a 128 bit hash.
 
@@ -430,28 +701,162 @@ public:
 	static void BatchAddSHA256To(size_t no, Hash256 *hashs, const char **data, size_t *length);
 };
 
+namespace Impl {
+	//! CityHash's Hash128to64, which mixes 128 bits to 64 with three multiplies
+	inline unsigned long long hash_mix128(unsigned long long lo, unsigned long long hi)
+	{
+		const unsigned long long kMul=0x9ddfea08eb382d69ULL;
+		unsigned long long a=(lo^hi)*kMul;
+		a^=(a>>47);
+		unsigned long long b=(hi^a)*kMul;
+		b^=(b>>47);
+		return b*kMul;
+	}
+	//! Mixes 256 bits to 64 as two independent 128 bit mixes, which execute in parallel, then a third
+	inline unsigned long long hash_mix256(const unsigned long long *w)
+	{
+		return hash_mix128(hash_mix128(w[0], w[1]), hash_mix128(w[2], w[3]));
+	}
+}
+
+/*! \struct truncating_hash
+\brief Hashes Int128, Int256 and their Ref views by their first size_t, which is ideal for digests as their bits are
+already uniformly random. This is what std::hash does by default.
+*/
+struct truncating_hash
+{
+	typedef void is_transparent;
+	size_t operator()(const Int128 &v) const { return v.asSize_t(); }
+	size_t operator()(const Int256 &v) const { return v.asSize_t(); }
+	size_t operator()(const Int128Ref &v) const { return v.asSize_t(); }
+	size_t operator()(const Int256Ref &v) const { return v.asSize_t(); }
+};
+
+/*! \struct mixing_hash
+\brief Hashes Int128, Int256 and their Ref views by mixing all their bits with CityHash's Hash128to64.
+
+Use this for Int128s and Int256s holding structured values such as counters, IPv6 addresses or (pointer, version)
+pairs, whose first size_t varies little or only in its low or high bits, which truncating_hash would cluster into a
+few buckets. Int256s are mixed as two independent halves which are then mixed together. On an Intel Xeon virtual
+machine this costs approx. 1ns more per lookup than truncating_hash.
+*/
+struct mixing_hash
+{
+	typedef void is_transparent;
+	size_t operator()(const Int128 &v) const { return (size_t) Impl::hash_mix128(v.asLongLongs()[0], v.asLongLongs()[1]); }
+	size_t operator()(const Int256 &v) const { return (size_t) Impl::hash_mix256(v.asLongLongs()); }
+	size_t operator()(const Int128Ref &v) const
+	{
+		unsigned long long w[2];
+		memcpy(w, v.asBytes(), sizeof(w));
+		return (size_t) Impl::hash_mix128(w[0], w[1]);
+	}
+	size_t operator()(const Int256Ref &v) const
+	{
+		unsigned long long w[4];
+		memcpy(w, v.asBytes(), sizeof(w));
+		return (size_t) Impl::hash_mix256(w);
+	}
+};
+
+/*! \struct hash_selector
+\brief A trait selecting whether std::hash of Int128, Int256, Hash128 or Hash256 is truncating_hash or mixing_hash.
+
+By default every std::hash truncates. If your program keeps structured values in Int128 or Int256 rather than
+digests, specialise this to select mixing_hash for them, e.g.
+\code
+namespace NiallsCPP11Utilities { template<> struct hash_selector<Int128> { typedef mixing_hash type; }; }
+\endcode
+after which std::hash of Int128 and Int128Ref, and so every unordered_map and FlatHashMap using them, mixes. The
+specialisation must be declared before the first use of std::hash of that type in each translation unit, typically
+straight after including this header, and must be the same in every translation unit of the program. Hash128 and
+Hash256 are selected separately and so keep truncating.
+*/
+template<class T> struct hash_selector { typedef truncating_hash type; };
+
+namespace Impl {
+	// Looks up hash_selector<T> only once U is known, so a specialisation following this header is still seen
+	template<class T, class U> struct hash_selected
+	{
+		static_assert(std::is_convertible<const U &, typename std::conditional<std::is_base_of<Int128, T>::value, Int128Ref, Int256Ref>::type>::value, "std::hash of an Int128 or Int256 can only hash that type or its Ref view");
+		typedef typename hash_selector<T>::type type;
+	};
+}
+
 } //namespace
 
 namespace std
 {
-	//! Defines a hash for a Int128 (simply truncates)
+	//! Defines a hash for a Int128, truncating unless hash_selector<Int128> selects mixing_hash. Also hashes Int128Ref identically for heterogeneous lookup.
 	template<> class hash<NiallsCPP11Utilities::Int128>
 	{
 	public:
-		size_t operator()(const NiallsCPP11Utilities::Int128 &v) const
+		typedef void is_transparent;
+		template<class U> size_t operator()(const U &v) const
 		{
-			return v.asSize_t();
+			return typename NiallsCPP11Utilities::Impl::hash_selected<NiallsCPP11Utilities::Int128, U>::type()(v);
 		}
 	};
-	//! Defines a hash for a Int256 (simply truncates)
+	//! Defines a hash for a Int256, truncating unless hash_selector<Int256> selects mixing_hash. Also hashes Int256Ref identically for heterogeneous lookup.
 	template<> class hash<NiallsCPP11Utilities::Int256>
 	{
 	public:
-		size_t operator()(const NiallsCPP11Utilities::Int256 &v) const
+		typedef void is_transparent;
+		template<class U> size_t operator()(const U &v) const
 		{
-			return v.asSize_t();
+			return typename NiallsCPP11Utilities::Impl::hash_selected<NiallsCPP11Utilities::Int256, U>::type()(v);
 		}
 	};
+	//! Defines a hash for a Hash128, truncating unless hash_selector<Hash128> selects mixing_hash
+	template<> class hash<NiallsCPP11Utilities::Hash128>
+	{
+	public:
+		typedef void is_transparent;
+		template<class U> size_t operator()(const U &v) const
+		{
+			return typename NiallsCPP11Utilities::Impl::hash_selected<NiallsCPP11Utilities::Hash128, U>::type()(v);
+		}
+	};
+	//! Defines a hash for a Hash256, truncating unless hash_selector<Hash256> selects mixing_hash
+	template<> class hash<NiallsCPP11Utilities::Hash256>
+	{
+	public:
+		typedef void is_transparent;
+		template<class U> size_t operator()(const U &v) const
+		{
+			return typename NiallsCPP11Utilities::Impl::hash_selected<NiallsCPP11Utilities::Hash256, U>::type()(v);
+		}
+	};
+	//! Defines a hash for a Int128Ref, the same as of the Int128 viewed
+	template<> class hash<NiallsCPP11Utilities::Int128Ref> : public hash<NiallsCPP11Utilities::Int128>
+	{
+	};
+	//! Defines a hash for a Int256Ref, the same as of the Int256 viewed
+	template<> class hash<NiallsCPP11Utilities::Int256Ref> : public hash<NiallsCPP11Utilities::Int256>
+	{
+	};
+	//! Defines an equality comparison for a Int128 which also accepts Int128Ref for heterogeneous lookup
+	template<> struct equal_to<NiallsCPP11Utilities::Int128>
+	{
+		typedef void is_transparent;
+		bool operator()(const NiallsCPP11Utilities::Int128 &a, const NiallsCPP11Utilities::Int128 &b) const { return a==b; }
+		bool operator()(const NiallsCPP11Utilities::Int128Ref &a, const NiallsCPP11Utilities::Int128Ref &b) const { return a==b; }
+	};
+	//! Defines an equality comparison for a Int256 which also accepts Int256Ref for heterogeneous lookup
+	template<> struct equal_to<NiallsCPP11Utilities::Int256>
+	{
+		typedef void is_transparent;
+		bool operator()(const NiallsCPP11Utilities::Int256 &a, const NiallsCPP11Utilities::Int256 &b) const { return a==b; }
+		bool operator()(const NiallsCPP11Utilities::Int256Ref &a, const NiallsCPP11Utilities::Int256Ref &b) const { return a==b; }
+	};
+	//! Defines an equality comparison for a Hash128 which also accepts Int128Ref for heterogeneous lookup
+	template<> struct equal_to<NiallsCPP11Utilities::Hash128> : public equal_to<NiallsCPP11Utilities::Int128>
+	{
+	};
+	//! Defines an equality comparison for a Hash256 which also accepts Int256Ref for heterogeneous lookup
+	template<> struct equal_to<NiallsCPP11Utilities::Hash256> : public equal_to<NiallsCPP11Utilities::Int256>
+	{
+	};
 #define TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE NiallsCPP11Utilities::Int128
 #include "incl_stl_allocator_override.hpp"
 #undef TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE
@@ -468,8 +873,10 @@ namespace std
 
 namespace NiallsCPP11Utilities {
 	inline void Int128::FillFastRandom(std::vector<Int128> &ints) { FillFastRandom(ints.data(), ints.size()); }
+	inline void Int128::FillFastRandom(std::vector<Int128> &ints, unsigned long long seed, unsigned long long offset) { FillFastRandom(ints.data(), ints.size(), seed, offset); }
 	inline void Int128::FillQualityRandom(std::vector<Int128> &ints) { FillQualityRandom(ints.data(), ints.size()); }
 	inline void Int256::FillFastRandom(std::vector<Int256> &ints) { FillFastRandom(ints.data(), ints.size()); }
+	inline void Int256::FillFastRandom(std::vector<Int256> &ints, unsigned long long seed, unsigned long long offset) { FillFastRandom(ints.data(), ints.size(), seed, offset); }
 	inline void Int256::FillQualityRandom(std::vector<Int256> &ints) { FillQualityRandom(ints.data(), ints.size()); }
 }
 
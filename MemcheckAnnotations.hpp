@@ -0,0 +1,125 @@
+/* MemcheckAnnotations.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Tells Valgrind's memcheck and AddressSanitizer which blocks of the pooled
+allocators are in use, compiling away in release builds.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_MEMCHECKANNOTATIONS_H
+#define NIALLSCPP11UTILITIES_MEMCHECKANNOTATIONS_H
+
+/*! \file MemcheckAnnotations.hpp
+\brief Provides the memory checking tool annotations used by the pooled allocators
+*/
+
+#include "NiallsCPP11Utilities.hpp"
+
+//! \def NIALLSCPP11UTILITIES_ASAN Defined to 1 if this translation unit is being instrumented by AddressSanitizer
+#ifndef NIALLSCPP11UTILITIES_ASAN
+#if defined(__SANITIZE_ADDRESS__)
+#define NIALLSCPP11UTILITIES_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NIALLSCPP11UTILITIES_ASAN 1
+#endif
+#endif
+#endif
+#ifndef NIALLSCPP11UTILITIES_ASAN
+#define NIALLSCPP11UTILITIES_ASAN 0
+#endif
+
+/*! \def NIALLSCPP11UTILITIES_MEMCHECK Nonzero if the pooled allocators tell Valgrind and AddressSanitizer which of their
+blocks are in use. Defaults to on in debug builds and in builds instrumented by AddressSanitizer, and off otherwise, in
+which case the annotations compile to nothing.
+*/
+#ifndef NIALLSCPP11UTILITIES_MEMCHECK
+#if !defined(NDEBUG) || NIALLSCPP11UTILITIES_ASAN
+#define NIALLSCPP11UTILITIES_MEMCHECK 1
+#else
+#define NIALLSCPP11UTILITIES_MEMCHECK 0
+#endif
+#endif
+
+#if NIALLSCPP11UTILITIES_MEMCHECK
+#include "valgrind/memcheck.h"
+#if NIALLSCPP11UTILITIES_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+#endif
+
+//! \def NOSANITIZEADDRESS The markup this compiler uses to stop AddressSanitizer checking the accesses of a function
+#ifndef NOSANITIZEADDRESS
+#if NIALLSCPP11UTILITIES_ASAN && defined(__GNUC__)
+#define NOSANITIZEADDRESS __attribute__((no_sanitize_address))
+#else
+#define NOSANITIZEADDRESS
+#endif
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+#if NIALLSCPP11UTILITIES_MEMCHECK
+	//! Tells the tools \em bytes at \em p must not be accessed
+	inline void memcheck_noaccess(const void *p, size_t bytes) noexcept
+	{
+		VALGRIND_MAKE_MEM_NOACCESS(p, bytes);
+#if NIALLSCPP11UTILITIES_ASAN
+		ASAN_POISON_MEMORY_REGION(p, bytes);
+#endif
+	}
+	//! Tells the tools \em bytes at \em p may be accessed but hold nothing yet
+	inline void memcheck_undefined(const void *p, size_t bytes) noexcept
+	{
+#if NIALLSCPP11UTILITIES_ASAN
+		ASAN_UNPOISON_MEMORY_REGION(p, bytes);
+#endif
+		VALGRIND_MAKE_MEM_UNDEFINED(p, bytes);
+	}
+	//! Tells the tools \em bytes at \em p may be accessed and hold values
+	inline void memcheck_defined(const void *p, size_t bytes) noexcept
+	{
+#if NIALLSCPP11UTILITIES_ASAN
+		ASAN_UNPOISON_MEMORY_REGION(p, bytes);
+#endif
+		VALGRIND_MAKE_MEM_DEFINED(p, bytes);
+	}
+	//! Registers a pool of blocks with Valgrind, identified by the address \em pool
+	inline void memcheck_create_pool(const void *pool) noexcept { VALGRIND_CREATE_MEMPOOL(pool, 0, 0); }
+	//! Tells the tools a block of \em bytes at \em p has been allocated from \em pool
+	inline void memcheck_pool_alloc(const void *pool, const void *p, size_t bytes) noexcept
+	{
+#if NIALLSCPP11UTILITIES_ASAN
+		ASAN_UNPOISON_MEMORY_REGION(p, bytes);
+#endif
+		VALGRIND_MEMPOOL_ALLOC(pool, p, bytes);
+	}
+	//! Tells the tools the block at \em p, of \em bytes including any slack, has been returned to \em pool
+	inline void memcheck_pool_free(const void *pool, const void *p, size_t bytes) noexcept
+	{
+		VALGRIND_MEMPOOL_FREE(pool, p);
+#if NIALLSCPP11UTILITIES_ASAN
+		ASAN_POISON_MEMORY_REGION(p, bytes);
+#else
+		(void) bytes;
+#endif
+	}
+	//! Stops the tools reporting errors from the calling thread until memcheck_report_errors()
+	inline void memcheck_ignore_errors() noexcept { VALGRIND_DISABLE_ERROR_REPORTING; }
+	inline void memcheck_report_errors() noexcept { VALGRIND_ENABLE_ERROR_REPORTING; }
+#else
+	inline void memcheck_noaccess(const void *, size_t) noexcept { }
+	inline void memcheck_undefined(const void *, size_t) noexcept { }
+	inline void memcheck_defined(const void *, size_t) noexcept { }
+	inline void memcheck_create_pool(const void *) noexcept { }
+	inline void memcheck_pool_alloc(const void *, const void *, size_t) noexcept { }
+	inline void memcheck_pool_free(const void *, const void *, size_t) noexcept { }
+	inline void memcheck_ignore_errors() noexcept { }
+	inline void memcheck_report_errors() noexcept { }
+#endif
+}
+
+} // namespace
+
+#endif
@@ -136,6 +136,22 @@ namespace std {
 #endif
 #endif
 
+//! \def CACHELINESIZE The distance apart two objects must be for writes to one not to falsely share the cache line of the other
+#ifndef CACHELINESIZE
+#define CACHELINESIZE 64
+#endif
+
+//! \def THREADLOCALPOD The markup this compiler uses to mark a POD variable as having thread local storage
+#ifndef THREADLOCALPOD
+#ifdef _MSC_VER
+#define THREADLOCALPOD __declspec(thread)
+#elif defined(__GNUC__)
+#define THREADLOCALPOD __thread
+#else
+#define THREADLOCALPOD unknown_thread_local_pod_markup_for_this_compiler
+#endif
+#endif
+
 #ifdef NIALLSCPP11UTILITIES_DLL_EXPORTS
 #define NIALLSCPP11UTILITIES_API DLLEXPORTMARKUP
 #else
@@ -343,6 +359,8 @@ namespace detail {
 		return _aligned_malloc(size, align);
 #else
 		void *ret=nullptr;
+		// posix_memalign() rejects alignments of less than a pointer
+		if(align<sizeof(void *)) align=sizeof(void *);
 		if(posix_memalign(&ret, align, size)) return nullptr;
 		return ret;
 #endif
@@ -540,12 +558,23 @@ template<> class PadSizeToMultipleOfImpl<0>
 };
 /*! \brief Rounds a type to a given multiple of a size
 */
-template<class T, size_t sizemultiple=std::alignment_of<T>::value> struct PadSizeToMultipleOf : public T, private PadSizeToMultipleOfImpl<(sizemultiple-1+sizeof(T)) % sizemultiple>
+template<class T, size_t sizemultiple=std::alignment_of<T>::value> struct PadSizeToMultipleOf : public T, private PadSizeToMultipleOfImpl<(sizemultiple-sizeof(T)%sizemultiple) % sizemultiple>
 {
 public:
-	PadSizeToMultipleOf() { }
+	PadSizeToMultipleOf() : T() { }
 	template<class A> PadSizeToMultipleOf(const A &o) : T(o) { }
-	template<class A> PadSizeToMultipleOf(A &&o) : T(std::move(o)) { }
+	template<class A> PadSizeToMultipleOf(A &&o) : T(std::forward<A>(o)) { }
+};
+/*! \brief Pads and aligns a type to whole cache lines, so writes to it never falsely share a cache line with anything else
+
+Unlike PadSizeToMultipleOf this also aligns, which means a heap allocated CacheLinePadded needs an aligned allocator
+such as aligned_allocator<CacheLinePadded<T>, CACHELINESIZE>.
+*/
+template<class T> struct TYPEALIGNMENT(CACHELINESIZE) CacheLinePadded : public PadSizeToMultipleOf<T, CACHELINESIZE>
+{
+public:
+	CacheLinePadded() : PadSizeToMultipleOf<T, CACHELINESIZE>() { }
+	template<class A> CacheLinePadded(A &&o) : PadSizeToMultipleOf<T, CACHELINESIZE>(std::forward<A>(o)) { }
 };
 
 template<class T> struct TextDumpImpl
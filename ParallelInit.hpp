@@ -0,0 +1,137 @@
+/* ParallelInit.hpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Parallel first touch initialisation of large buffers, and an allocator adaptor
+leaving items uninitialised so they can be.
+*/
+
+#ifndef NIALLSCPP11UTILITIES_PARALLELINIT_H
+#define NIALLSCPP11UTILITIES_PARALLELINIT_H
+
+/*! \file ParallelInit.hpp
+\brief Provides parallel_uninitialized_fill, parallel_fill_random and default_init_allocator
+*/
+
+#include "Int128_256.hpp"
+#include <exception>
+
+namespace NiallsCPP11Utilities {
+
+/*! \struct leave_uninitialised
+\brief True if default constructing a T may be skipped, leaving whatever bytes its storage held
+
+Defaults to std::is_trivially_constructible. Int128 and Int256 zero themselves on construction but have no invariant
+needing it, so are specialised true. Hash128 and Hash256 are not, as they construct to the initial state of a hash.
+*/
+template<class T> struct leave_uninitialised : std::integral_constant<bool, std::is_trivially_constructible<T>::value> { };
+template<> struct leave_uninitialised<Int128> : std::true_type { };
+template<> struct leave_uninitialised<Int256> : std::true_type { };
+
+namespace Impl {
+	//! Items are initialised in pieces of at least this many bytes, so each thread touches whole pages
+	static const size_t parallel_init_chunk=65536;
+	//! Below this many bytes initialisation is done on the calling thread
+	static const size_t parallel_init_threshold=1<<20;
+}
+
+/*! \brief Copy constructs \em value into the uninitialised storage [first, last) from many threads.
+
+Memory is placed on the NUMA node of the thread which first touches it, so a buffer initialised on one thread lives
+on one node and is zeroed serially. This constructs the items with an OpenMP static schedule in 64Kb pieces, so if the
+buffer is later processed with `#pragma omp parallel for schedule(static)` each thread mostly works on memory local to
+it. Buffers under 1Mb are done on the calling thread. If a copy throws, all the items constructed are destroyed and
+the first exception thrown is rethrown.
+*/
+template<class T> inline void parallel_uninitialized_fill(T *first, T *last, const T &value)
+{
+	const size_t no=last-first, chunk=(Impl::parallel_init_chunk+sizeof(T)-1)/sizeof(T);
+	if(no*sizeof(T)<Impl::parallel_init_threshold)
+	{
+		std::uninitialized_fill(first, last, value);
+		return;
+	}
+	const ptrdiff_t chunks=(ptrdiff_t)((no+chunk-1)/chunk);
+	std::vector<size_t> done(chunks);
+	std::exception_ptr e;
+	bool failed=false;
+#pragma omp parallel for schedule(static)
+	for(ptrdiff_t n=0; n<chunks; n++)
+	{
+		T *p=first+n*chunk, *end=(last-p>(ptrdiff_t) chunk) ? p+chunk : last;
+		try
+		{
+			for(; p<end; p++, done[n]++)
+				::new((void *) p) T(value);
+		}
+		catch(...)
+		{
+#pragma omp critical
+			if(!failed)
+			{
+				failed=true;
+				e=std::current_exception();
+			}
+		}
+	}
+	if(failed)
+	{
+		for(ptrdiff_t n=0; n<chunks; n++)
+			for(size_t i=0; i<done[n]; i++)
+				first[n*chunk+i].~T();
+		std::rethrow_exception(e);
+	}
+}
+
+/*! \brief Fills [first, last) with fast random numbers from many threads, as Int128::FillFastRandom() or
+Int256::FillFastRandom() with the same \em seed and \em offset.
+
+The storage may be uninitialised, as Int128 and Int256 may be left uninitialised. As FillFastRandom() does, this fills
+the items with an OpenMP static schedule, each piece from its own offset into the Philox stream, so the result is
+the same however many threads fill it and later processing with `#pragma omp parallel for schedule(static)` mostly
+works on memory local to each thread.
+*/
+inline void parallel_fill_random(Int128 *first, Int128 *last, unsigned long long seed, unsigned long long offset=0) { Int128::FillFastRandom(first, last-first, seed, offset); }
+//! \overload
+inline void parallel_fill_random(Int256 *first, Int256 *last, unsigned long long seed, unsigned long long offset=0) { Int256::FillFastRandom(first, last-first, seed, offset); }
+
+/*! \class default_init_allocator
+\brief An STL allocator adaptor which default initialises rather than value initialises items, and leaves items
+for which leave_uninitialised is true entirely uninitialised.
+
+A std::vector<Int256>(n) zeroes every item on the constructing thread before it can be filled in parallel. A
+std::vector<Int256, default_init_allocator<aligned_allocator<Int256, 32>>>(n) leaves its items as the memory came,
+so it can be filled by parallel_fill_random() or some other parallel loop. Its resize() likewise does not initialise
+the new items. Construction with arguments is passed through to \em Alloc.
+*/
+template <class Alloc>
+class default_init_allocator : public Alloc
+{
+	typedef std::allocator_traits<Alloc> int_traits;
+	template<class U> void int_construct(U *p, std::true_type) { (void) p; }
+	template<class U> void int_construct(U *p, std::false_type) { ::new((void *) p) U; }
+public:
+	template <class U>
+	struct rebind { typedef default_init_allocator<typename int_traits::template rebind_alloc<U>> other; };
+
+	default_init_allocator() { }
+	default_init_allocator(const Alloc &allocator) : Alloc(allocator) { }
+	template <class A>
+	default_init_allocator(const default_init_allocator<A> &o) : Alloc(static_cast<const A &>(o)) { }
+
+	//! Default initialises, or leaves uninitialised, an item
+	template <class U>
+	void construct(U* p) { int_construct(p, std::integral_constant<bool, leave_uninitialised<U>::value>()); }
+	template <class U, class A, class ...Args>
+	void construct(U* p, A &&a, Args&&... args) { int_traits::construct(static_cast<Alloc &>(*this), p, std::forward<A>(a), std::forward<Args>(args)...); }
+};
+
+template <class A, class B>
+inline bool operator==(const default_init_allocator<A> &a, const default_init_allocator<B> &b) { return static_cast<const A &>(a)==static_cast<const B &>(b); }
+
+template <class A, class B>
+inline bool operator!=(const default_init_allocator<A> &a, const default_init_allocator<B> &b) { return !(static_cast<const A &>(a)==static_cast<const B &>(b)); }
+
+} // namespace
+
+#endif
@@ -0,0 +1,56 @@
+/* PerCpu.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Finds the CPU the calling thread is running on.
+*/
+
+#include "PerCpu.hpp"
+#include <thread>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	size_t percpu_slots() noexcept
+	{
+		static const size_t slots=[]{
+			size_t cpus=std::thread::hardware_concurrency(), n=1;
+			while(n<cpus) n<<=1;
+			return n;
+		}();
+		return slots;
+	}
+
+	// Threads are numbered from one in the order they first ask, zero meaning not yet numbered
+	static std::atomic<size_t> percpu_threads;
+	static THREADLOCALPOD size_t percpu_thread;
+	static size_t percpu_thread_index() noexcept
+	{
+		size_t ret=percpu_thread;
+		if(!ret)
+			percpu_thread=ret=++percpu_threads;
+		return ret-1;
+	}
+
+	size_t percpu_current() noexcept
+	{
+#ifdef WIN32
+		return GetCurrentProcessorNumber();
+#elif defined(__linux__)
+		// Reads the vDSO or restartable sequence area, so does not enter the kernel
+		int cpu=sched_getcpu();
+		if(cpu>=0) return (size_t) cpu;
+		return percpu_thread_index();
+#else
+		return percpu_thread_index();
+#endif
+	}
+}
+
+} // namespace
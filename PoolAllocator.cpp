@@ -0,0 +1,286 @@
+/* PoolAllocator.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+A size class pool of aligned blocks with per thread caches, refilled from and
+flushed to global lock free transfer lists.
+*/
+
+#include "PoolAllocator.hpp"
+#include "AtomicInt128.hpp"
+#include "MemcheckAnnotations.hpp"
+#include <atomic>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	static const size_t pool_classes=14;
+	// Each size is naturally aligned to the largest power of two dividing it, up to pool_max_align
+	static const size_t pool_sizes[pool_classes]={ 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+	static const size_t pool_slab=65536;
+	// Blocks move between threads in batches of this many
+	static const size_t pool_batch=32;
+
+	static inline size_t pool_natural_align(size_t size)
+	{
+		size_t align=size & (0-size);
+		return align<pool_max_align ? align : pool_max_align;
+	}
+	// Returns the smallest size class holding bytes at the alignment
+	static inline size_t pool_class(size_t bytes, size_t align)
+	{
+		size_t c;
+		if(bytes<=64)
+			c=bytes ? (bytes-1)>>4 : 0;
+		else
+			for(c=4; pool_sizes[c]<bytes; c++);
+		while(pool_natural_align(pool_sizes[c])<align) c++;
+		return c;
+	}
+
+	/* Free blocks are linked through their first word. The first block of a batch on a transfer list links the next
+	batch through its second word, which every size class has room for. Free blocks are inaccessible to the memory
+	checking tools, so only the link being read or written is opened up, and only for that access.
+	*/
+	static inline void *pool_link(void *block, size_t n)
+	{
+		void **link=static_cast<void **>(block)+n;
+		memcheck_defined(link, sizeof(void *));
+		void *ret=*link;
+		memcheck_noaccess(link, sizeof(void *));
+		return ret;
+	}
+	static inline void pool_setlink(void *block, size_t n, void *value)
+	{
+		void **link=static_cast<void **>(block)+n;
+		memcheck_undefined(link, sizeof(void *));
+		*link=value;
+		memcheck_noaccess(link, sizeof(void *));
+	}
+	static inline void *pool_next(void *block) { return pool_link(block, 0); }
+	/* The batch being popped may meanwhile be popped and used or pushed again by another thread, so its link is read
+	without opening it up, which could race with that thread's annotations.
+	*/
+	static NOSANITIZEADDRESS void *pool_peeknextbatch(void *block)
+	{
+		memcheck_ignore_errors();
+		void *ret=static_cast<void *volatile *>(block)[1];
+		memcheck_report_errors();
+		return ret;
+	}
+	// Blocks are registered with Valgrind against this address
+	static const void *const pool_anchor=pool_sizes;
+
+	// Only used on the slow paths, and constructed on first use so it is ready for allocations during static initialisation
+	struct PoolGlobals
+	{
+		AtomicInt128 transfers[pool_classes];	// (first block of batch, version)
+		std::atomic<void *> slabs;			// Every slab ever allocated, linked through its first word
+		std::atomic<size_t> reserved;
+		PoolGlobals() : slabs(nullptr), reserved(0) { memcheck_create_pool(pool_anchor); }
+	};
+	static PoolGlobals &pool_globals()
+	{
+		static PoolGlobals globals;
+		return globals;
+	}
+	static Int128 pool_pack(void *p, unsigned long long version)
+	{
+		TYPEALIGNMENT(16) unsigned long long words[2]={ (unsigned long long)(size_t) p, version };
+		return Int128((const char *) words);
+	}
+	static void pool_push_batch(size_t c, void *batch)
+	{
+		AtomicInt128 &head=pool_globals().transfers[c];
+		Int128 expected(head.load(std::memory_order_relaxed));
+		do
+		{
+			pool_setlink(batch, 1, (void *)(size_t) expected.asLongLongs()[0]);
+		} while(!head.compare_exchange_weak(expected, pool_pack(batch, expected.asLongLongs()[1]+1)));
+	}
+	static void *pool_pop_batch(size_t c)
+	{
+		AtomicInt128 &head=pool_globals().transfers[c];
+		Int128 expected(head.load(std::memory_order_relaxed));
+		void *batch;
+		do
+		{
+			batch=(void *)(size_t) expected.asLongLongs()[0];
+			if(!batch) return nullptr;
+			// Slabs are never freed, so reading a batch popped by another thread meanwhile is harmless and the version catches it
+		} while(!head.compare_exchange_weak(expected, pool_pack(pool_peeknextbatch(batch), expected.asLongLongs()[1]+1)));
+		return batch;
+	}
+
+	struct PoolCache
+	{
+		struct List
+		{
+			void *head;
+			size_t count;	// At least the blocks in the list
+			char *carve, *carveend;
+		} lists[pool_classes];
+	};
+	static THREADLOCALPOD PoolCache *poolcache;
+
+	// Moves all the blocks of a list to the transfer list in batches
+	static void pool_flush(PoolCache::List &l, size_t c, size_t keep)
+	{
+		while(l.head && l.count>=keep+pool_batch)
+		{
+			void *first=l.head, *last=first;
+			for(size_t n=1; n<pool_batch && pool_next(last); n++)
+				last=pool_next(last);
+			l.head=pool_next(last);
+			pool_setlink(last, 0, nullptr);
+			l.count-=pool_batch;
+			pool_push_batch(c, first);
+		}
+		if(!keep && l.head)
+		{
+			pool_push_batch(c, l.head);
+			l.head=nullptr;
+		}
+		if(!l.head) l.count=0;
+	}
+	static void DeletePoolCache(void *p)
+	{
+		PoolCache *cache=(PoolCache *) p;
+		for(size_t c=0; c<pool_classes; c++)
+			pool_flush(cache->lists[c], c, 0);
+		if(poolcache==cache) poolcache=nullptr;
+		detail::deallocate_aligned_memory(cache);
+	}
+
+	// The thread's cache is owned by a TLS key whose destructor flushes and deletes it at thread exit
+#ifdef WIN32
+	static VOID WINAPI FlsDeletePoolCache(PVOID p) { if(p) DeletePoolCache(p); }
+	static DWORD pool_key()
+	{
+		static const DWORD key=FlsAlloc(FlsDeletePoolCache);
+		return key;
+	}
+	static void SetPoolCacheOwner(PoolCache *cache) { FlsSetValue(pool_key(), cache); }
+#else
+	static pthread_key_t pool_key()
+	{
+		static struct Init
+		{
+			pthread_key_t key;
+			Init() { pthread_key_create(&key, DeletePoolCache); }
+		} init;
+		return init.key;
+	}
+	static void SetPoolCacheOwner(PoolCache *cache) { pthread_setspecific(pool_key(), cache); }
+#endif
+	static PoolCache *pool_cache()
+	{
+		PoolCache *cache=poolcache;
+		if(!cache)
+		{
+			cache=(PoolCache *) detail::allocate_aligned_memory(64, sizeof(PoolCache));
+			if(!cache) throw std::bad_alloc();
+			memset(cache, 0, sizeof(PoolCache));
+			SetPoolCacheOwner(cache);
+			poolcache=cache;
+		}
+		return cache;
+	}
+
+	// Refills an empty list from the transfer list, else carves a block from the thread's slab
+	static void *pool_refill(PoolCache::List &l, size_t c)
+	{
+		void *batch=pool_pop_batch(c);
+		if(batch)
+		{
+			l.head=pool_next(batch);
+			l.count=pool_batch-1;
+			return batch;
+		}
+		const size_t size=pool_sizes[c];
+		if(l.carve+size>l.carveend)
+		{
+			PoolGlobals &globals=pool_globals();
+			char *slab=(char *) detail::allocate_aligned_memory(pool_max_align, pool_slab);
+			if(!slab) throw std::bad_alloc();
+			void *expected=globals.slabs.load(std::memory_order_relaxed);
+			do
+			{
+				*(void **) slab=expected;
+			} while(!globals.slabs.compare_exchange_weak(expected, slab));
+			globals.reserved.fetch_add(pool_slab, std::memory_order_relaxed);
+			// The first line holds the slab link
+			l.carve=slab+pool_max_align;
+			memcheck_noaccess(l.carve, pool_slab-pool_max_align);
+			l.carveend=slab+pool_slab;
+		}
+		void *ret=l.carve;
+		l.carve+=size;
+		return ret;
+	}
+
+	void *pool_allocate(size_t bytes, size_t align)
+	{
+		if(bytes>pool_max_block || align>pool_max_align)
+		{
+			void *ret=detail::allocate_aligned_memory(align<sizeof(void *) ? sizeof(void *) : align, bytes);
+			if(!ret) throw std::bad_alloc();
+			return ret;
+		}
+		size_t c=pool_class(bytes, align);
+		PoolCache::List &l=pool_cache()->lists[c];
+		void *ret=l.head;
+		if(ret)
+		{
+			l.head=pool_next(ret);
+			if(l.count) l.count--;
+		}
+		else
+			ret=pool_refill(l, c);
+		// Only the bytes asked for become accessible, so overrunning into the size class's slack is caught too
+		memcheck_pool_alloc(pool_anchor, ret, bytes);
+		return ret;
+	}
+
+	void pool_deallocate(void *p, size_t bytes, size_t align) noexcept
+	{
+		if(!p) return;
+		if(bytes>pool_max_block || align>pool_max_align)
+		{
+			detail::deallocate_aligned_memory(p);
+			return;
+		}
+		size_t c=pool_class(bytes, align);
+		memcheck_pool_free(pool_anchor, p, pool_sizes[c]);
+		PoolCache *cache=poolcache;
+		if(!cache)
+		{
+			// A thread which only frees still needs a cache, and if one cannot be had the block goes straight to the transfer list
+			try { cache=pool_cache(); }
+			catch(...)
+			{
+				pool_setlink(p, 0, nullptr);
+				pool_push_batch(c, p);
+				return;
+			}
+		}
+		PoolCache::List &l=cache->lists[c];
+		pool_setlink(p, 0, l.head);
+		l.head=p;
+		if(++l.count>=2*pool_batch)
+			pool_flush(l, c, pool_batch);
+	}
+
+	size_t pool_reserved_bytes() noexcept
+	{
+		return pool_globals().reserved.load(std::memory_order_relaxed);
+	}
+}
+
+} // namespace
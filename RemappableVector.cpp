@@ -0,0 +1,71 @@
+/* RemappableVector.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+Maps the storage of large remappable_vectors, and grows it by remapping.
+*/
+
+#include "RemappableVector.hpp"
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+#ifdef WIN32
+	void *remap_allocate(size_t bytes)
+	{
+		void *ret=VirtualAlloc(NULL, remap_round(bytes), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+		if(!ret) throw std::bad_alloc();
+		return ret;
+	}
+	void *remap_reallocate(void *p, size_t oldbytes, size_t newbytes, bool maymove) noexcept
+	{
+		// Windows cannot move pages, and as VirtualFree() releases only the original reservation it cannot grow either
+		return remap_round(newbytes)==remap_round(oldbytes) ? p : nullptr;
+	}
+	void remap_deallocate(void *p, size_t bytes) noexcept
+	{
+		VirtualFree(p, 0, MEM_RELEASE);
+	}
+#elif defined(__linux__)
+	void *remap_allocate(size_t bytes)
+	{
+		void *ret=mmap(nullptr, remap_round(bytes), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if(MAP_FAILED==ret) throw std::bad_alloc();
+		return ret;
+	}
+	void *remap_reallocate(void *p, size_t oldbytes, size_t newbytes, bool maymove) noexcept
+	{
+		// Fails with ENOMEM if the pages after the mapping are in use and it may not move
+		void *ret=mremap(p, remap_round(oldbytes), remap_round(newbytes), maymove ? MREMAP_MAYMOVE : 0);
+		return MAP_FAILED==ret ? nullptr : ret;
+	}
+	void remap_deallocate(void *p, size_t bytes) noexcept
+	{
+		munmap(p, remap_round(bytes));
+	}
+#else
+	// Without mapping these are plain page aligned allocations which always grow by moving
+	void *remap_allocate(size_t bytes)
+	{
+		void *ret=detail::allocate_aligned_memory(remap_page_size, remap_round(bytes));
+		if(!ret) throw std::bad_alloc();
+		return ret;
+	}
+	void *remap_reallocate(void *p, size_t oldbytes, size_t newbytes, bool maymove) noexcept
+	{
+		return remap_round(newbytes)==remap_round(oldbytes) ? p : nullptr;
+	}
+	void remap_deallocate(void *p, size_t bytes) noexcept
+	{
+		detail::deallocate_aligned_memory(p);
+	}
+#endif
+}
+
+} // namespace
@@ -0,0 +1,161 @@
+/* Sketches.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+SimHash and MinHash similarity sketches of documents, built from shingles
+hashed in batches by CityHash.
+*/
+
+#include "Sketches.hpp"
+#include <cstring>
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include "hashes/cityhash/src/city.h"
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	// Texts at least this long are sketched in parallel segments
+	static const size_t sketch_parallel=1<<20;
+
+	// Returns the first position from pos which is a word byte if word, else a separator. Bytes of 0x20 and below separate words.
+	static inline size_t sketch_find(const unsigned char *text, size_t pos, size_t length, bool word)
+	{
+#if HAVE_M128
+		const __m128i space=_mm_set1_epi8(0x20);
+		for(; pos+16<=length; pos+=16)
+		{
+			__m128i v=_mm_loadu_si128((const __m128i *)(text+pos));
+			unsigned m=(unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, space), v));
+			if(word) m=~m & 0xffff;
+			if(m) return pos+bitset_lowest_bit(m);
+		}
+#endif
+		while(pos<length && (text[pos]>0x20)!=word) pos++;
+		return pos;
+	}
+	// Hashes a word. Words of up to 16 bytes are zero padded to 16 bytes and mixed without branching on their length,
+	// which is unambiguous as words never contain zero bytes. Where 16 bytes can be read they are masked in a SSE2
+	// register, else near the end of the text they are copied, which must hash the same.
+	static inline unsigned long long sketch_hash_word(const unsigned char *text, size_t start, size_t end, size_t length)
+	{
+		if(end-start<=16)
+		{
+			TYPEALIGNMENT(16) unsigned long long w[2];
+#if HAVE_M128
+			static const unsigned char masks[32]={ 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+			if(start+16<=length)
+			{
+				__m128i mask=_mm_loadu_si128((const __m128i *)(masks+16-(end-start)));
+				_mm_store_si128((__m128i *) w, _mm_and_si128(_mm_loadu_si128((const __m128i *)(text+start)), mask));
+				return Hash128to64(uint128(w[0], w[1]));
+			}
+#else
+			(void) length;
+#endif
+			w[0]=w[1]=0;
+			memcpy(w, text+start, end-start);
+			return Hash128to64(uint128(w[0], w[1]));
+		}
+		return CityHash64((const char *) text+start, end-start);
+	}
+	// Combines the hashes of the words of a shingle in order
+	static inline unsigned long long sketch_combine(const unsigned long long *ring, size_t width, size_t first, size_t no)
+	{
+		unsigned long long h=ring[first];
+		for(size_t n=1; n<no; n++)
+		{
+			if(++first==width) first=0;
+			h=Hash128to64(uint128(h, ring[first]));
+		}
+		return h;
+	}
+	// Hashes the shingles whose first word starts in [begin, end)
+	static void sketch_hash_segment(const char *_text, size_t length, size_t width, size_t segment, size_t begin, size_t end, const SketchSink &sink)
+	{
+		const unsigned char *text=(const unsigned char *) _text;
+		std::vector<unsigned long long> ring(width);
+		std::vector<size_t> starts(width);
+		unsigned long long hashes[sketch_batch];
+		size_t nohashes=0, words=0, slot=0, pos=begin;
+		// A word straddling begin belongs to the previous segment
+		if(pos>0 && pos<length && text[pos-1]>0x20)
+			pos=sketch_find(text, pos, length, false);
+		for(;;)
+		{
+			size_t start=sketch_find(text, pos, length, true);
+			if(start>=length || (!words && start>=end))
+				break;
+			pos=sketch_find(text, start, length, false);
+			ring[slot]=sketch_hash_word(text, start, pos, length);
+			starts[slot]=start;
+			if(++slot==width) slot=0;
+			// Once the ring is full the oldest word, in the slot to be written next, starts the shingle
+			if(++words>=width)
+			{
+				if(starts[slot]>=end)
+					break;
+				hashes[nohashes++]=sketch_combine(ring.data(), width, slot, width);
+				if(sketch_batch==nohashes)
+				{
+					sink(segment, hashes, nohashes);
+					nohashes=0;
+				}
+			}
+		}
+		// A text of fewer than width words is one shingle, emitted by the segment holding its first word
+		if(words && words<width && sketch_find(text, 0, starts[0], true)==starts[0])
+			hashes[nohashes++]=sketch_combine(ring.data(), width, 0, words);
+		if(nohashes)
+			sink(segment, hashes, nohashes);
+	}
+
+	void sketch_hash_shingles(unsigned long long *hashes, size_t no, const char *const *shingles, const size_t *lengths)
+	{
+		for(size_t n=0; n<no; n++)
+			hashes[n]=CityHash64(shingles[n], lengths[n]);
+	}
+
+	size_t sketch_text_segments(size_t length)
+	{
+#ifdef _OPENMP
+		if(length>=sketch_parallel)
+			return (size_t) omp_get_max_threads();
+#endif
+		return 1;
+	}
+
+	void sketch_hash_text(const char *text, size_t length, size_t width, const SketchSink &sink)
+	{
+		if(!width) width=1;
+		int segments=(int) sketch_text_segments(length);
+#pragma omp parallel for schedule(static, 1) if(segments>1)
+		for(int s=0; s<segments; s++)
+			sketch_hash_segment(text, length, width, s, length*s/segments, length*(s+1)/segments, sink);
+	}
+
+	const unsigned *sketch_minhash_constants()
+	{
+		// Generated by SplitMix64 with a fixed seed so signatures are comparable across builds and platforms
+		static struct constants_t
+		{
+			unsigned table[2048];
+			constants_t()
+			{
+				unsigned long long x=0x6d696e68617368ULL;
+				for(size_t n=0; n<2048; n++)
+					table[n]=(unsigned)(sketch_mix64(x+=0x9e3779b97f4a7c15ULL)>>32) | (n<1024);
+			}
+		} constants;
+		return constants.table;
+	}
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+/* TrackingAllocator.cpp
+(C) 2026 Niall Douglas http://www.nedprod.com/
+File Created: Oct 2026
+
+The per thread blocks of tracking_allocator counts, and their summing.
+*/
+
+#include "TrackingAllocator.hpp"
+#include <cstring>
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace NiallsCPP11Utilities {
+
+namespace Impl {
+	/* A thread's TLS key holds the address of its thread local block pointer, so at thread exit the destructor can free
+	the block for reuse and reset the pointer in case the thread allocates again during its exit.
+	*/
+	static void ReleaseTrackingBlock(void *p)
+	{
+		TrackingBlock **tls=(TrackingBlock **) p;
+		if(*tls)
+		{
+			(*tls)->inuse.store(false, std::memory_order_release);
+			*tls=nullptr;
+		}
+	}
+#ifdef WIN32
+	static VOID WINAPI FlsReleaseTrackingBlock(PVOID p) { if(p) ReleaseTrackingBlock(p); }
+#endif
+
+	TrackingRegistry::TrackingRegistry() : myblocks(nullptr), myflushed(0), mypeak(0)
+	{
+		memset(&mybaseline, 0, sizeof(mybaseline));
+#ifdef WIN32
+		mykey=FlsAlloc(FlsReleaseTrackingBlock);
+#else
+		pthread_key_t key;
+		pthread_key_create(&key, ReleaseTrackingBlock);
+		mykey=(size_t) key;
+#endif
+	}
+
+	TrackingBlock *TrackingRegistry::claim(TrackingBlock **tls)
+	{
+		TrackingBlock *b;
+		// Reuse the block of an exited thread, keeping its counts
+		for(b=myblocks.load(std::memory_order_acquire); b; b=b->next)
+		{
+			bool expected=false;
+			if(!b->inuse.load(std::memory_order_relaxed) && b->inuse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				break;
+		}
+		if(!b)
+		{
+			b=(TrackingBlock *) detail::allocate_aligned_memory(CACHELINESIZE, sizeof(TrackingBlock));
+			if(!b) throw std::bad_alloc();
+			::new(b) TrackingBlock();
+			b->inuse.store(true, std::memory_order_relaxed);
+			TrackingBlock *expected=myblocks.load(std::memory_order_relaxed);
+			do
+			{
+				b->next=expected;
+			} while(!myblocks.compare_exchange_weak(expected, b, std::memory_order_release));
+		}
+#ifdef WIN32
+		FlsSetValue((DWORD) mykey, tls);
+#else
+		pthread_setspecific((pthread_key_t) mykey, tls);
+#endif
+		*tls=b;
+		return b;
+	}
+
+	void TrackingRegistry::flush(TrackingBlock &b) noexcept
+	{
+		long long unflushed=b.unflushed.load(std::memory_order_relaxed);
+		b.unflushed.store(0, std::memory_order_relaxed);
+		long long total=myflushed.fetch_add(unflushed, std::memory_order_relaxed)+unflushed;
+		long long peak=mypeak.load(std::memory_order_relaxed);
+		while(total>peak && !mypeak.compare_exchange_weak(peak, total, std::memory_order_relaxed));
+	}
+
+	TrackingSnapshot TrackingRegistry::int_sum() const noexcept
+	{
+		TrackingSnapshot ret;
+		memset(&ret, 0, sizeof(ret));
+		for(TrackingBlock *b=myblocks.load(std::memory_order_acquire); b; b=b->next)
+		{
+			ret.bytes+=b->bytes.load(std::memory_order_relaxed);
+			ret.allocations+=b->allocations.load(std::memory_order_relaxed);
+			ret.deallocations+=b->deallocations.load(std::memory_order_relaxed);
+			for(size_t n=0; n<tracking_buckets; n++)
+				ret.histogram[n]+=b->histogram[n].load(std::memory_order_relaxed);
+		}
+		ret.live=ret.allocations-ret.deallocations;
+		return ret;
+	}
+
+	TrackingSnapshot TrackingRegistry::snapshot() const noexcept
+	{
+		TrackingSnapshot ret(int_sum());
+		ret.peakbytes=mypeak.load(std::memory_order_relaxed);
+		if(ret.bytes>ret.peakbytes) ret.peakbytes=ret.bytes;
+		std::lock_guard<std::mutex> g(mylock);
+		ret.allocations-=mybaseline.allocations;
+		ret.deallocations-=mybaseline.deallocations;
+		for(size_t n=0; n<tracking_buckets; n++)
+			ret.histogram[n]-=mybaseline.histogram[n];
+		return ret;
+	}
+
+	void TrackingRegistry::reset() noexcept
+	{
+		// The blocks are only written by their threads, so rather than zero them remember what they held
+		TrackingSnapshot now(int_sum());
+		std::lock_guard<std::mutex> g(mylock);
+		mybaseline=now;
+		mypeak.store(now.bytes, std::memory_order_relaxed);
+	}
+}
+
+} // namespace
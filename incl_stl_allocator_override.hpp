@@ -10,10 +10,255 @@
 		template <class InputIterator> vector (InputIterator first, InputIterator last,
 			const allocator_type& alloc = allocator_type()) : Base(first, last, alloc) { }
 		vector (const vector& x) : Base(x) { }
-		//vector (const vector& x, const allocator_type& alloc) : Base(x, alloc) { }
 		vector (vector&& x) : Base(std::move(x)) { }
-		//vector (vector&& x, const allocator_type& alloc) : Base(std::move(x), alloc) { }
-#if defined(_MSC_VER) && _MSC_VER>1700
+#if !defined(_MSC_VER) || _MSC_VER>1700
 		vector (initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) : Base(il, alloc) { }
 #endif
+		vector& operator= (const vector& x) { Base::operator=(x); return *this; }
+		vector& operator= (vector&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::deque<> doing unaligned storage, taking its blocks from the pool
+	template<> class deque<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public deque<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef deque<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		explicit deque (const allocator_type& alloc = allocator_type()) : Base(alloc) { }
+		explicit deque (size_type n) : Base(n) { }
+		deque (size_type n, const value_type& val,
+			const allocator_type& alloc = allocator_type()) : Base(n, val, alloc) { }
+		template <class InputIterator> deque (InputIterator first, InputIterator last,
+			const allocator_type& alloc = allocator_type()) : Base(first, last, alloc) { }
+		deque (const deque& x) : Base(x) { }
+		deque (deque&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		deque (initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) : Base(il, alloc) { }
+#endif
+		deque& operator= (const deque& x) { Base::operator=(x); return *this; }
+		deque& operator= (deque&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::list<> doing unaligned storage, taking its nodes from the pool
+	template<> class list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		explicit list (const allocator_type& alloc = allocator_type()) : Base(alloc) { }
+		explicit list (size_type n) : Base(n) { }
+		list (size_type n, const value_type& val,
+			const allocator_type& alloc = allocator_type()) : Base(n, val, alloc) { }
+		template <class InputIterator> list (InputIterator first, InputIterator last,
+			const allocator_type& alloc = allocator_type()) : Base(first, last, alloc) { }
+		list (const list& x) : Base(x) { }
+		list (list&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		list (initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) : Base(il, alloc) { }
+#endif
+		list& operator= (const list& x) { Base::operator=(x); return *this; }
+		list& operator= (list&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::forward_list<> doing unaligned storage, taking its nodes from the pool
+	template<> class forward_list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public forward_list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef forward_list<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		explicit forward_list (const allocator_type& alloc = allocator_type()) : Base(alloc) { }
+		explicit forward_list (size_type n) : Base(n) { }
+		forward_list (size_type n, const value_type& val,
+			const allocator_type& alloc = allocator_type()) : Base(n, val, alloc) { }
+		template <class InputIterator> forward_list (InputIterator first, InputIterator last,
+			const allocator_type& alloc = allocator_type()) : Base(first, last, alloc) { }
+		forward_list (const forward_list& x) : Base(x) { }
+		forward_list (forward_list&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		forward_list (initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) : Base(il, alloc) { }
+#endif
+		forward_list& operator= (const forward_list& x) { Base::operator=(x); return *this; }
+		forward_list& operator= (forward_list&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::set<> doing unaligned storage, taking its nodes from the pool
+	template<class Compare> class set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		typedef typename Base::key_compare key_compare;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		explicit set (const key_compare& comp = key_compare(),
+			const allocator_type& alloc = allocator_type()) : Base(comp, alloc) { }
+		template <class InputIterator> set (InputIterator first, InputIterator last,
+			const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(first, last, comp, alloc) { }
+		set (const set& x) : Base(x) { }
+		set (set&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		set (initializer_list<value_type> il, const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(il, comp, alloc) { }
+#endif
+		set& operator= (const set& x) { Base::operator=(x); return *this; }
+		set& operator= (set&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::multiset<> doing unaligned storage, taking its nodes from the pool
+	template<class Compare> class multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Compare, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		typedef typename Base::key_compare key_compare;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		explicit multiset (const key_compare& comp = key_compare(),
+			const allocator_type& alloc = allocator_type()) : Base(comp, alloc) { }
+		template <class InputIterator> multiset (InputIterator first, InputIterator last,
+			const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(first, last, comp, alloc) { }
+		multiset (const multiset& x) : Base(x) { }
+		multiset (multiset&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		multiset (initializer_list<value_type> il, const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(il, comp, alloc) { }
+#endif
+		multiset& operator= (const multiset& x) { Base::operator=(x); return *this; }
+		multiset& operator= (multiset&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::map<> keyed by the type doing unaligned storage, taking its nodes from the pool
+	template<class Value, class Compare> class map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> : public map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>>
+	{
+		typedef map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> Base;
+	public:
+		typedef typename Base::key_compare key_compare;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		explicit map (const key_compare& comp = key_compare(),
+			const allocator_type& alloc = allocator_type()) : Base(comp, alloc) { }
+		template <class InputIterator> map (InputIterator first, InputIterator last,
+			const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(first, last, comp, alloc) { }
+		map (const map& x) : Base(x) { }
+		map (map&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		map (initializer_list<value_type> il, const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(il, comp, alloc) { }
+#endif
+		map& operator= (const map& x) { Base::operator=(x); return *this; }
+		map& operator= (map&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::multimap<> keyed by the type doing unaligned storage, taking its nodes from the pool
+	template<class Value, class Compare> class multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> : public multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>>
+	{
+		typedef multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Compare, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> Base;
+	public:
+		typedef typename Base::key_compare key_compare;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		explicit multimap (const key_compare& comp = key_compare(),
+			const allocator_type& alloc = allocator_type()) : Base(comp, alloc) { }
+		template <class InputIterator> multimap (InputIterator first, InputIterator last,
+			const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(first, last, comp, alloc) { }
+		multimap (const multimap& x) : Base(x) { }
+		multimap (multimap&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		multimap (initializer_list<value_type> il, const key_compare& comp = key_compare(), const allocator_type& alloc = allocator_type()) : Base(il, comp, alloc) { }
+#endif
+		multimap& operator= (const multimap& x) { Base::operator=(x); return *this; }
+		multimap& operator= (multimap&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::unordered_set<> doing unaligned storage, taking its nodes and buckets from the pool
+	template<class Hash, class Pred> class unordered_set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public unordered_set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef unordered_set<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		typedef typename Base::size_type size_type;
+		typedef typename Base::hasher hasher;
+		typedef typename Base::key_equal key_equal;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		unordered_set () { }
+		explicit unordered_set (size_type n, const hasher& hf = hasher(), const key_equal& eql = key_equal(),
+			const allocator_type& alloc = allocator_type()) : Base(n, hf, eql, alloc) { }
+		template <class InputIterator> unordered_set (InputIterator first, InputIterator last) : Base(first, last) { }
+		template <class InputIterator> unordered_set (InputIterator first, InputIterator last, size_type n,
+			const hasher& hf = hasher(), const key_equal& eql = key_equal(), const allocator_type& alloc = allocator_type()) : Base(first, last, n, hf, eql, alloc) { }
+		unordered_set (const unordered_set& x) : Base(x) { }
+		unordered_set (unordered_set&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		unordered_set (initializer_list<value_type> il) : Base(il) { }
+#endif
+		unordered_set& operator= (const unordered_set& x) { Base::operator=(x); return *this; }
+		unordered_set& operator= (unordered_set&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::unordered_multiset<> doing unaligned storage, taking its nodes and buckets from the pool
+	template<class Hash, class Pred> class unordered_multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> : public unordered_multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>>
+	{
+		typedef unordered_multiset<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Hash, Pred, NiallsCPP11Utilities::pool_allocator<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE>> Base;
+	public:
+		typedef typename Base::size_type size_type;
+		typedef typename Base::hasher hasher;
+		typedef typename Base::key_equal key_equal;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		unordered_multiset () { }
+		explicit unordered_multiset (size_type n, const hasher& hf = hasher(), const key_equal& eql = key_equal(),
+			const allocator_type& alloc = allocator_type()) : Base(n, hf, eql, alloc) { }
+		template <class InputIterator> unordered_multiset (InputIterator first, InputIterator last) : Base(first, last) { }
+		template <class InputIterator> unordered_multiset (InputIterator first, InputIterator last, size_type n,
+			const hasher& hf = hasher(), const key_equal& eql = key_equal(), const allocator_type& alloc = allocator_type()) : Base(first, last, n, hf, eql, alloc) { }
+		unordered_multiset (const unordered_multiset& x) : Base(x) { }
+		unordered_multiset (unordered_multiset&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		unordered_multiset (initializer_list<value_type> il) : Base(il) { }
+#endif
+		unordered_multiset& operator= (const unordered_multiset& x) { Base::operator=(x); return *this; }
+		unordered_multiset& operator= (unordered_multiset&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::unordered_map<> keyed by the type doing unaligned storage, taking its nodes and buckets from the pool
+	template<class Value, class Hash, class Pred> class unordered_map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> : public unordered_map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>>
+	{
+		typedef unordered_map<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> Base;
+	public:
+		typedef typename Base::size_type size_type;
+		typedef typename Base::hasher hasher;
+		typedef typename Base::key_equal key_equal;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		unordered_map () { }
+		explicit unordered_map (size_type n, const hasher& hf = hasher(), const key_equal& eql = key_equal(),
+			const allocator_type& alloc = allocator_type()) : Base(n, hf, eql, alloc) { }
+		template <class InputIterator> unordered_map (InputIterator first, InputIterator last) : Base(first, last) { }
+		template <class InputIterator> unordered_map (InputIterator first, InputIterator last, size_type n,
+			const hasher& hf = hasher(), const key_equal& eql = key_equal(), const allocator_type& alloc = allocator_type()) : Base(first, last, n, hf, eql, alloc) { }
+		unordered_map (const unordered_map& x) : Base(x) { }
+		unordered_map (unordered_map&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		unordered_map (initializer_list<value_type> il) : Base(il) { }
+#endif
+		unordered_map& operator= (const unordered_map& x) { Base::operator=(x); return *this; }
+		unordered_map& operator= (unordered_map&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
+	};
+	//! Stop the default std::unordered_multimap<> keyed by the type doing unaligned storage, taking its nodes and buckets from the pool
+	template<class Value, class Hash, class Pred> class unordered_multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> : public unordered_multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>>
+	{
+		typedef unordered_multimap<TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value, Hash, Pred, NiallsCPP11Utilities::pool_allocator<pair<const TYPE_TO_BE_OVERRIDEN_FOR_STL_ALLOCATOR_USAGE, Value>>> Base;
+	public:
+		typedef typename Base::size_type size_type;
+		typedef typename Base::hasher hasher;
+		typedef typename Base::key_equal key_equal;
+		typedef typename Base::value_type value_type;
+		typedef typename Base::allocator_type allocator_type;
+		unordered_multimap () { }
+		explicit unordered_multimap (size_type n, const hasher& hf = hasher(), const key_equal& eql = key_equal(),
+			const allocator_type& alloc = allocator_type()) : Base(n, hf, eql, alloc) { }
+		template <class InputIterator> unordered_multimap (InputIterator first, InputIterator last) : Base(first, last) { }
+		template <class InputIterator> unordered_multimap (InputIterator first, InputIterator last, size_type n,
+			const hasher& hf = hasher(), const key_equal& eql = key_equal(), const allocator_type& alloc = allocator_type()) : Base(first, last, n, hf, eql, alloc) { }
+		unordered_multimap (const unordered_multimap& x) : Base(x) { }
+		unordered_multimap (unordered_multimap&& x) : Base(std::move(x)) { }
+#if !defined(_MSC_VER) || _MSC_VER>1700
+		unordered_multimap (initializer_list<value_type> il) : Base(il) { }
+#endif
+		unordered_multimap& operator= (const unordered_multimap& x) { Base::operator=(x); return *this; }
+		unordered_multimap& operator= (unordered_multimap&& x) { Base::operator=(std::move(x)); return *this; }
+		using Base::operator=;
 	};
@@ -9,10 +9,42 @@ File Created: Nov 2012
 #include "NiallsCPP11Utilities.hpp"
 #include "catch.hpp"
 #include "Int128_256.hpp"
+#include "FlatHashMap.hpp"
+#include "AtomicInt128.hpp"
+#include "SimdBitset.hpp"
+#include "DigestFilters.hpp"
+#include "ContentChunker.hpp"
+#include "DigestIndex.hpp"
+#include "Hamming.hpp"
+#include "Sketches.hpp"
+#include "CountingSketches.hpp"
+#include "ConsistentHashing.hpp"
+#include "Arena.hpp"
+#include "PoolAllocator.hpp"
+#include "HugePageAllocator.hpp"
+#include "RemappableVector.hpp"
+#include "SmallAlignedVector.hpp"
+#include "PerCpu.hpp"
+#include "TrackingAllocator.hpp"
+#include "ParallelInit.hpp"
+#include "MemcheckAnnotations.hpp"
 #include <stdio.h>
 #include <fstream>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <bitset>
+#include <list>
+#include <deque>
+#include <forward_list>
+#include <set>
+#include <unordered_set>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #ifdef WIN32
 extern "C" char* __cdecl __unDName(char* buffer, const char* mangled, int buflen,
@@ -20,6 +52,9 @@ extern "C" char* __cdecl __unDName(char* buffer, const char* mangled, int buflen
                       unsigned short int flags);
 #endif
 
+// Selects mixing_hash for Hash128 before any use of std::hash<Hash128>, as a user program would
+namespace NiallsCPP11Utilities { template<> struct hash_selector<Hash128> { typedef mixing_hash type; }; }
+
 using namespace NiallsCPP11Utilities;
 using namespace std;
 
@@ -422,6 +457,2249 @@ TEST_CASE("Int256/works", "Tests that Int256 works")
 	CHECK((comparisons1==comparisons2));
 }
 
+TEST_CASE("FillFastRandom/reproducible", "Tests that the counter based FillFastRandom is reproducible and partitionable")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	// Random123 known answer test for Philox4x32-10 with zero key and counter
+	vector<Int128> kat(1);
+	Int128::FillFastRandom(kat, 0);
+	CHECK(kat[0].asInts()[0]==0x6627e8d5);
+	CHECK(kat[0].asInts()[1]==0xe169c58d);
+	CHECK(kat[0].asInts()[2]==0xbc57ac4c);
+	CHECK(kat[0].asInts()[3]==0x9b00dbd8);
+
+	// Filling in separate partitions must give the same result as one big fill
+	vector<Int128> a(100003), b(a.size());
+	Int128::FillFastRandom(a, 78);
+	for(size_t n=0; n<b.size(); n+=997)
+		Int128::FillFastRandom(b.data()+n, min((size_t) 997, b.size()-n), 78, n);
+	CHECK((a==b));
+	Int128::FillFastRandom(b, 79);
+	CHECK(a[0]!=b[0]);
+	Int128::FillFastRandom(b);
+	CHECK(a[0]!=b[0]);
+
+	// Int256 shares the Int128 byte stream
+	vector<Int256> c(a.size()/2);
+	Int256::FillFastRandom(c, 78);
+	CHECK(!memcmp(a.data(), c.data(), c.size()*sizeof(Int256)));
+	Int256::FillFastRandom(c.data()+1, 1, 78, 5);
+	CHECK(!memcmp(a.data()+10, c.data()+1, sizeof(Int256)));
+
+	vector<Int256> big(1<<20);
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<20; m++)
+			Int256::FillFastRandom(big, m);
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "FillFastRandom of 32Mb does " << (CPU_CYCLES_PER_SEC*diff.count())/(20*big.size()*sizeof(Int256)) << " cycles/byte" << endl;
+	}
+}
+
+TEST_CASE("FillQualityRandom/works", "Tests that FillQualityRandom produces unpredictable output")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	// Odd sizes exercise the partial final requests
+	vector<Int128> a(4099*17), b(a.size());
+	Int128::FillQualityRandom(a);
+	Int128::FillQualityRandom(b);
+	CHECK(a[0]!=b[0]);
+	CHECK(a.back()!=b.back());
+	size_t zeros=0, bits=0;
+	for(size_t n=0; n<a.size(); n++)
+	{
+		if(a[n]==Int128()) zeros++;
+		for(int i=0; i<4; i++)
+		{
+			unsigned int v=a[n].asInts()[i];
+			for(; v; v&=v-1) bits++;
+		}
+	}
+	CHECK(zeros==0);
+	// Half the bits should be set, and 8 standard deviations is ~0.2%
+	double ratio_set=bits/(128.0*a.size());
+	CHECK(ratio_set>0.498);
+	CHECK(ratio_set<0.502);
+
+	vector<Int256> big(1<<20);
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<10; m++)
+			Int256::FillQualityRandom(big);
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "FillQualityRandom of 32Mb does " << (CPU_CYCLES_PER_SEC*diff.count())/(10*big.size()*sizeof(Int256)) << " cycles/byte" << endl;
+	}
+}
+
+TEST_CASE("FillQualityRandom/knownanswers", "Tests the FillQualityRandom generators against known answers")
+{
+	auto tohex=[](const char *p, size_t len)
+	{
+		static const char digits[]="0123456789abcdef";
+		string ret;
+		for(size_t n=0; n<len; n++)
+		{
+			ret.push_back(digits[(p[n]>>4)&15]);
+			ret.push_back(digits[p[n]&15]);
+		}
+		return ret;
+	};
+	char out[256];
+	unsigned char key[32];
+	// RFC 7539 appendix A.1 ChaCha20 block function test vectors 1 to 3
+	memset(key, 0, sizeof(key));
+	Impl::quality_random_chacha20(out, 64, key, 0);
+	CHECK(tohex(out, 64)=="76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586");
+	Impl::quality_random_chacha20(out, 64, key, 1);
+	CHECK(tohex(out, 64)=="9f07e7be5551387a98ba977c732d080dcb0f29a048e3656912c6533e32ee7aed29b721769ce64e43d57133b074d839d531ed1f28510afb45ace10a1f4b794d6f");
+	key[31]=1;
+	Impl::quality_random_chacha20(out, 64, key, 1);
+	CHECK(tohex(out, 64)=="3aeb5224ecf849929b9d828db1ced4dd832025e8018b8160b82284f3c949aa5a8eca00bbb4a73bdad192b5c42f73f2fd4e273644c8b36125a64addeb006c13a0");
+	// A partial final block, checked against OpenSSL
+	for(int n=0; n<32; n++)
+		key[n]=(unsigned char) n;
+	Impl::quality_random_chacha20(out, 100, key, 5);
+	CHECK(tohex(out, 100)=="0be7ffa5fa90293ceda7b19d2a9741d1545f1ec0adf49ca599aca44e3567c05a206ffc953274f6e500ff395d44ff12b27a067f5c5178b1a42a1bb03748b79504fe1dadd8a3542859730d4d4282696e42c94fb555a0ee87a4cbd6220bd5bfe5037370dade");
+
+	// SP 800-90A AES-128 CTR_DRBG without derivation function, instantiated and generating twice as NIST's tests
+	// do, checked against an implementation using OpenSSL's AES
+	if(Impl::quality_random_ctr_drbg(out, 64, key))
+	{
+		CHECK(tohex(out, 64)=="796037fe48c39bf610f8a85a98565d96094b2d53595ffe0fc61be739c21d939418c5b8c55816d23aeadeee4cef57b30e543d58712f7c891721a1233da10cd90b");
+		// Partial blocks, and eight block batches with and without the counter carrying into its top half
+		REQUIRE(Impl::quality_random_ctr_drbg(out, 200, key));
+		CHECK(tohex(out, 200)=="13bc0d3e8d78b882ba039736ef38b348dc5f2830b83ef31734e98d9f3b998192f748c5992508998b75933d48fbeb835632c38ce6db94083c8d1d95ec98cf06c4a332ed0a1a1574910232d32cc047a4c8f83670f9f3101d81991130416fb172e200a617e88b26aa21909e88ec59b2cfda766a4d3a2bc3bcd1ceb2b5cef870a05c030a9a6b4b514022eebd9ca1e14fa99a2396f42b2e9fe199ca26a633f1f703e605e600e4735206b7350ea7bd446a0e4af71d57106ad7bb51364507ae02dd6089f709a56427b604a9");
+		// This entropy leaves the counter twelve below a carry into its top half
+		static const unsigned char carry[32]={0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0x0c, 0xd7, 0x3d, 0x46, 0x8e, 0x4d, 0x01, 0x8c};
+		REQUIRE(Impl::quality_random_ctr_drbg(out, 256, carry));
+		CHECK(tohex(out, 256)=="da68162b27534be2eb0d24f50dfef90d3079875027f7c9dbc5fd1aaafda7c70590fd8c3cc4032df44e3278122094de74ae3273947eb96c826b628f5027848696a336647eb0d0fa53d72449d665db2af4e6d5f1272e8754b009c76627c46d857f1dd2203aac4e1e7ea325b1e42af1d2391d03d2df0808856203a7ed65996d44f300f23cf03b9b5ea4ed22352542db83ae637e8a66891d0c1d65a7928de084dde93c130fb4b40068727e42d83bcd093dc97d955141c9b1648450a4cb347f65632ecca874a421eac2bde95dc3fb607360ebe48a868fd34231e0737afcc1023fb47e9e57ce71a57fbb122c58fc56928a5a585e4676474d60a8867ec070f7ea67f661");
+	}
+	else
+		cout << "This CPU lacks AES-NI, so the CTR_DRBG known answers were not tested" << endl;
+}
+
+TEST_CASE("FillRandom/threadlocal", "Tests that single value random fills are cheap, thread independent and fork safe")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	Int128 a, b;
+	Int128::FillFastRandom(&a, 1);
+	Int128::FillFastRandom(&b, 1);
+	CHECK(a!=b);
+	Int128::FillQualityRandom(&a, 1);
+	Int128::FillQualityRandom(&b, 1);
+	CHECK(a!=b);
+	{
+		// Other threads must not share this thread's streams
+		Int128 c, d;
+		std::thread([&c, &d]{ Int128::FillFastRandom(&c, 1); Int128::FillQualityRandom(&d, 1); }).join();
+		Int128::FillFastRandom(&a, 1);
+		Int128::FillQualityRandom(&b, 1);
+		CHECK(a!=c);
+		CHECK(b!=d);
+	}
+#ifndef WIN32
+	{
+		// A forked child must not repeat what its parent generates next
+		int fds[2];
+		REQUIRE(!pipe(fds));
+		pid_t pid=fork();
+		if(!pid)
+		{
+			Int128 out[2];
+			Int128::FillFastRandom(out, 1);
+			Int128::FillQualityRandom(out+1, 1);
+			if(write(fds[1], out, sizeof(out))!=sizeof(out)) _exit(1);
+			_exit(0);
+		}
+		Int128 parent[2], child[2];
+		Int128::FillFastRandom(parent, 1);
+		Int128::FillQualityRandom(parent+1, 1);
+		CHECK(read(fds[0], child, sizeof(child))==sizeof(child));
+		int status;
+		waitpid(pid, &status, 0);
+		close(fds[0]);
+		close(fds[1]);
+		CHECK(parent[0]!=child[0]);
+		CHECK(parent[1]!=child[1]);
+	}
+#endif
+	{
+		const size_t iterations=1000000;
+		auto begin=chrono::high_resolution_clock::now();
+		for(size_t n=0; n<iterations; n++)
+			Int128::FillFastRandom(&a, 1);
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "FillFastRandom of one Int128 does " << (CPU_CYCLES_PER_SEC*diff.count())/iterations << " cycles/op" << endl;
+		begin=chrono::high_resolution_clock::now();
+		for(size_t n=0; n<iterations; n++)
+			Int128::FillQualityRandom(&a, 1);
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "FillQualityRandom of one Int128 does " << (CPU_CYCLES_PER_SEC*diff.count())/iterations << " cycles/op" << endl;
+	}
+}
+
+TEST_CASE("FlatHashMap/works", "Tests that FlatHashMap works")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	vector<Int256> keys(1<<20);
+	Int256::FillFastRandom(keys);
+	FlatHashMap<Int256, size_t> map;
+	unordered_map<Int256, size_t, hash<Int256>, equal_to<Int256>, aligned_allocator<pair<const Int256, size_t>, 32>> refmap;
+	size_t inserted=0, found=0;
+	for(size_t n=0; n<keys.size(); n++)
+	{
+		inserted+=map.insert(make_pair(keys[n], n)).second;
+		refmap.insert(make_pair(keys[n], n));
+	}
+	CHECK(inserted==keys.size());
+	CHECK(map.size()==keys.size());
+	CHECK_FALSE(map.insert(make_pair(keys[0], (size_t) 0)).second);
+	cout << "FlatHashMap uses " << map.memory_usage()/(double) map.size() << " bytes/item at a load factor of " << map.load_factor() << endl;
+	size_t foo=0;
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<4; m++)
+			for(size_t n=0; n<keys.size(); n++)
+				foo+=map.find(keys[n])->second;
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "FlatHashMap lookups does " << (CPU_CYCLES_PER_SEC*diff.count())/(4*keys.size()) << " cycles/op" << endl;
+	}
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<4; m++)
+			for(size_t n=0; n<keys.size(); n++)
+				foo-=refmap.find(keys[n])->second;
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "unordered_map lookups does " << (CPU_CYCLES_PER_SEC*diff.count())/(4*keys.size()) << " cycles/op" << endl;
+	}
+	CHECK(foo==0);
+	for(size_t n=0; n<keys.size(); n+=2)
+		map.erase(keys[n]);
+	for(size_t n=0; n<keys.size(); n++)
+	{
+		auto it=map.find(keys[n]);
+		found+=(n & 1) ? (it!=map.end() && it->second==n) : (it==map.end());
+	}
+	CHECK(found==keys.size());
+	CHECK(map.size()==keys.size()/2);
+	CHECK((size_t) distance(map.cbegin(), map.cend())==map.size());
+	FlatHashMap<Int256, size_t> map2(map);
+	CHECK(map2.size()==map.size());
+	CHECK(map2.at(keys[1])==1);
+	CHECK_THROWS(map2.at(keys[0]));
+	map2[keys[0]]=78;
+	CHECK(map2.count(keys[0])==1);
+	CHECK(map.count(keys[0])==0);
+	map.clear();
+	CHECK(map.empty());
+
+	vector<Int128> ints(4096);
+	vector<Hash128> hashes;
+	Int128::FillFastRandom(ints);
+	for(auto &i : ints)
+		hashes.push_back(Hash128(i.asBytes()));
+	FlatHashSet<Hash128> set(hashes.begin(), hashes.end());
+	CHECK(set.size()==hashes.size());
+	CHECK(set.count(hashes[78])==1);
+	CHECK(set.erase(hashes[78])==1);
+	CHECK(set.count(hashes[78])==0);
+
+	{
+		// Every key probes the same groups, so keys past a full group must survive its tombstones being copied
+		struct constant_hash { size_t operator()(const Int128 &) const { return 0; } };
+		FlatHashSet<Int128, constant_hash> colliding(17), assigned;
+		for(size_t n=0; n<17; n++)
+			colliding.insert(ints[n]);
+		CHECK(colliding.erase(ints[0])==1);
+		FlatHashSet<Int128, constant_hash> copied(colliding);
+		assigned=colliding;
+		size_t foundcopied=0, foundassigned=0;
+		for(size_t n=1; n<17; n++)
+		{
+			foundcopied+=copied.count(ints[n]);
+			foundassigned+=assigned.count(ints[n]);
+		}
+		CHECK(foundcopied==16);
+		CHECK(foundassigned==16);
+		CHECK(copied.count(ints[0])==0);
+		// Further inserts into the copy still work
+		for(size_t n=17; n<40; n++)
+			copied.insert(ints[n]);
+		size_t foundgrown=0;
+		for(size_t n=1; n<40; n++)
+			foundgrown+=copied.count(ints[n]);
+		CHECK(foundgrown==39);
+		CHECK(copied.size()==39);
+	}
+}
+
+TEST_CASE("Int256Ref/works", "Tests that unaligned Int128Ref/Int256Ref views compare, hash and look up like Int128/Int256")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	// Packed records put every digest at an odd address
+	const size_t recordsize=1+sizeof(Int256);
+	vector<Int256> keys(100000);
+	Int256::FillFastRandom(keys);
+	vector<char> records(1+keys.size()*recordsize);
+	for(size_t n=0; n<keys.size(); n++)
+		memcpy(records.data()+1+n*recordsize+1, keys[n].asBytes(), sizeof(Int256));
+	FlatHashMap<Int256, size_t> map;
+	for(size_t n=0; n<keys.size(); n++)
+		map[keys[n]]=n;
+	size_t equal=0, ordered=0, hashed=0, found=0;
+	for(size_t n=0; n<keys.size(); n++)
+	{
+		Int256Ref ref(records.data()+1+n*recordsize+1);
+		const Int256 &next=keys[(n+1)%keys.size()];
+		equal+=(ref==keys[n] && keys[n]==ref && ref!=next && !(ref<keys[n]) && ref.value()==keys[n]);
+		ordered+=((ref<next)==(keys[n]<next) && (next<ref)==(next<keys[n]));
+		hashed+=(hash<Int256Ref>()(ref)==hash<Int256>()(keys[n]));
+		auto it=map.find(ref);
+		found+=(it!=map.end() && it->second==n && map.count(ref)==1);
+	}
+	CHECK(equal==keys.size());
+	CHECK(ordered==keys.size());
+	CHECK(hashed==keys.size());
+	CHECK(found==keys.size());
+	Int256 missing;
+	Int256::FillFastRandom(&missing, 1);
+	CHECK(map.count(Int256Ref(missing))==0);
+
+	{
+		Int128 a;
+		Int128::FillFastRandom(&a, 1);
+		char buffer[17];
+		memcpy(buffer+1, a.asBytes(), sizeof(a));
+		Int128Ref ref(buffer+1);
+		CHECK(ref==a);
+		CHECK(a==ref);
+		CHECK(ref.asHexString()==a.asHexString());
+		CHECK(hash<Int128Ref>()(ref)==hash<Int128>()(a));
+		FlatHashSet<Int128> set;
+		set.insert(a);
+		CHECK(set.count(ref)==1);
+	}
+
+	// Sorted unaligned digests can be binary searched in place
+	vector<Int256Ref> refs;
+	for(size_t n=0; n<keys.size(); n++)
+		refs.push_back(Int256Ref(records.data()+1+n*recordsize+1));
+	sort(refs.begin(), refs.end());
+	size_t searched=0;
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(size_t n=0; n<keys.size(); n++)
+			searched+=binary_search(refs.begin(), refs.end(), Int256Ref(keys[n]));
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "Binary search of unaligned Int256Ref does " << (CPU_CYCLES_PER_SEC*diff.count())/keys.size() << " cycles/op" << endl;
+	}
+	CHECK(searched==keys.size());
+}
+
+TEST_CASE("AtomicInt128/works", "Tests that AtomicInt128 is atomic under contention")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	auto make=[](unsigned long long lo, unsigned long long hi) -> Int128 {
+		Int128 ret;
+		unsigned long long *p=const_cast<unsigned long long *>(ret.asLongLongs());
+		p[0]=lo; p[1]=hi;
+		return ret;
+	};
+	std::atomic<Int128> a;
+	cout << "AtomicInt128 is lock free: " << a.is_lock_free() << endl;
+	CHECK(a.load()==Int128());
+	a.store(make(1, 2));
+	CHECK(a.load()==make(1, 2));
+	Int128 expected;
+	CHECK_FALSE(a.compare_exchange_strong(expected, make(3, 4)));
+	CHECK(expected==make(1, 2));
+	CHECK(a.compare_exchange_strong(expected, make(3, 4)));
+	CHECK(a.exchange(make(~0ULL, 5))==make(3, 4));
+	CHECK(a.fetch_add(1)==make(~0ULL, 5));
+	CHECK(a.load()==make(0, 6));
+
+	const size_t threads=max(4U, thread::hardware_concurrency()), iterations=250000;
+	{
+		AtomicInt128 counter;
+		vector<thread> ts;
+		auto begin=chrono::high_resolution_clock::now();
+		for(size_t t=0; t<threads; t++)
+			ts.push_back(thread([&counter, iterations]{ for(size_t n=0; n<iterations; n++) counter.fetch_add(1); }));
+		for(auto &t : ts) t.join();
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "AtomicInt128 contended fetch_add does " << (CPU_CYCLES_PER_SEC*diff.count())/(threads*iterations) << " cycles/op" << endl;
+		CHECK(counter.load()==make(threads*iterations, 0));
+	}
+	{
+		Int128 counter;
+		mutex lock;
+		vector<thread> ts;
+		auto begin=chrono::high_resolution_clock::now();
+		for(size_t t=0; t<threads; t++)
+			ts.push_back(thread([&counter, &lock, iterations]{
+				for(size_t n=0; n<iterations; n++)
+				{
+					lock_guard<mutex> g(lock);
+					++const_cast<unsigned long long *>(counter.asLongLongs())[0];
+				}
+			}));
+		for(auto &t : ts) t.join();
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "std::mutex contended increment does " << (CPU_CYCLES_PER_SEC*diff.count())/(threads*iterations) << " cycles/op" << endl;
+	}
+	{
+		// An ABA safe Treiber stack of (pointer, version) pairs
+		struct node { node *next; };
+		vector<node> nodes(1024);
+		AtomicInt128 head;
+		for(size_t n=0; n<nodes.size(); n++)
+		{
+			Int128 old=head.load();
+			nodes[n].next=(node *) old.asLongLongs()[0];
+			head.store(make((unsigned long long) &nodes[n], old.asLongLongs()[1]+1));
+		}
+		auto pop=[&head, &make]() -> node * {
+			Int128 old=head.load();
+			node *n;
+			do
+			{
+				n=(node *) old.asLongLongs()[0];
+				if(!n) return nullptr;
+			} while(!head.compare_exchange_weak(old, make((unsigned long long) n->next, old.asLongLongs()[1]+1)));
+			return n;
+		};
+		auto push=[&head, &make](node *n) {
+			Int128 old=head.load();
+			do
+			{
+				n->next=(node *) old.asLongLongs()[0];
+			} while(!head.compare_exchange_weak(old, make((unsigned long long) n, old.asLongLongs()[1]+1)));
+		};
+		vector<thread> ts;
+		auto begin=chrono::high_resolution_clock::now();
+		for(size_t t=0; t<threads; t++)
+			ts.push_back(thread([&pop, &push, iterations]{
+				for(size_t n=0; n<iterations; n++)
+				{
+					node *a=pop(), *b=pop();
+					if(a) push(a);
+					if(b) push(b);
+				}
+			}));
+		for(auto &t : ts) t.join();
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "Lock free stack of AtomicInt128 does " << (CPU_CYCLES_PER_SEC*diff.count())/(4*threads*iterations) << " cycles/op" << endl;
+		size_t count=0;
+		while(pop()) count++;
+		CHECK(count==nodes.size());
+	}
+}
+
+TEST_CASE("SimdBitset/works", "Tests that SimdBitset matches std::bitset and is faster")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	{
+		// An odd size checks the unused bits are kept clear
+		static SimdBitset<1000> a, b;
+		std::bitset<1000> ra, rb;
+		ranctx gen;
+		raninit(&gen, 0x78adbcff);
+		for(size_t n=0; n<300; n++)
+		{
+			size_t x=ranval(&gen) % 1000, y=ranval(&gen) % 1000;
+			a.set(x); ra.set(x);
+			b.set(y); rb.set(y);
+		}
+		CHECK(a.count()==ra.count());
+		CHECK((a&b).count()==(ra&rb).count());
+		CHECK((a|b).count()==(ra|rb).count());
+		CHECK((a^b).count()==(ra^rb).count());
+		CHECK((~a).count()==(~ra).count());
+		CHECK(SimdBitset<1000>(a).andNot(b).count()==(ra&~rb).count());
+		CHECK_FALSE(a.all());
+		CHECK(SimdBitset<1000>().set().all());
+		CHECK(SimdBitset<1000>().none());
+		CHECK_THROWS(a.test(1000));
+		size_t mismatches=0, pos=0, k=0;
+		for(size_t n=0; n<1000; n++)
+			mismatches+=(a[n]!=ra[n]);
+		for(auto it=a.begin(); it!=a.end(); ++it, k++)
+		{
+			while(!ra[pos]) pos++;
+			mismatches+=(*it!=pos);
+			mismatches+=(a.rank(pos)!=k);
+			mismatches+=(a.select(k)!=pos);
+			pos++;
+		}
+		CHECK(mismatches==0);
+		CHECK(k==ra.count());
+		CHECK(a.select(k)==a.size());
+		CHECK(a.rank(a.size())==k);
+		k=0;
+		a.for_each_set([&k, &ra](size_t i) { k+=ra[i]; });
+		CHECK(k==ra.count());
+	}
+
+	static const size_t bits=1<<20;
+	static SimdBitset<bits> a, b;
+	static std::bitset<bits> ra, rb;
+	{
+		vector<Int256> random(2*SimdBitset<bits>::blocks);
+		Int256::FillFastRandom(random, 78);
+		memcpy((void *) a.data(), random.data(), sizeof(a));
+		memcpy((void *) b.data(), random.data()+SimdBitset<bits>::blocks, sizeof(b));
+		for(size_t n=0; n<bits; n++)
+		{
+			ra[n]=a[n];
+			rb[n]=b[n];
+		}
+	}
+	size_t count=0, refcount=0;
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<100; m++)
+		{
+			a^=b;
+			count+=(a&b).count();
+		}
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "SimdBitset<1M> xor, and and count does " << (CPU_CYCLES_PER_SEC*diff.count())/(100*bits/8) << " cycles/byte" << endl;
+	}
+	size_t fusedcount=0;
+	{
+		// An even number of xors leaves a as it was, so this counts the same intersections
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<100; m++)
+		{
+			a^=b;
+			fusedcount+=a.countAnd(b);
+		}
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "SimdBitset<1M> xor and countAnd does " << (CPU_CYCLES_PER_SEC*diff.count())/(100*bits/8) << " cycles/byte" << endl;
+	}
+	CHECK(fusedcount==count);
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<100; m++)
+		{
+			ra^=rb;
+			refcount+=(ra&rb).count();
+		}
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "std::bitset<1M> xor, and and count does " << (CPU_CYCLES_PER_SEC*diff.count())/(100*bits/8) << " cycles/byte" << endl;
+	}
+	CHECK(count==refcount);
+	{
+		size_t total=0;
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<10; m++)
+			a.for_each_set([&total](size_t i) { total+=i; });
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "SimdBitset<1M> set bit iteration does " << (CPU_CYCLES_PER_SEC*diff.count())/(10*a.count()) << " cycles/bit" << endl;
+		CHECK(total>0);
+	}
+}
+
+TEST_CASE("DigestFilters/works", "Tests the false positive rate and speed of DigestBloomFilter and DigestCuckooFilter")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	const size_t items=1<<20;
+	vector<Hash256> members(items), others(items);
+	Int256::FillFastRandom(members.data(), items, 78);
+	Int256::FillFastRandom(others.data(), items, 79);
+	std::unique_ptr<bool[]> results(new bool[items]);
+	for(double bitsperitem : { 8.0, 12.0, 16.0 })
+	{
+		DigestBloomFilter filter(items, bitsperitem);
+		for(size_t n=0; n<items; n++)
+			filter.insert(members[n]);
+		CHECK(filter.batchContains(items, members.data(), results.get())==items);
+		size_t falsepositives=0;
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<4; m++)
+			falsepositives=filter.batchContains(items, others.data(), results.get());
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		double fpr=(double) falsepositives/items;
+		cout << "DigestBloomFilter at " << bitsperitem << " bits/item has a false positive rate of " << 100*fpr << "% at " << (4*items/diff.count())/1000000 << "M queries/sec (batch), ";
+		CHECK(fpr<(bitsperitem<10 ? 0.05 : bitsperitem<14 ? 0.01 : 0.003));
+		size_t found=0;
+		begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<4; m++)
+			for(size_t n=0; n<items; n++)
+				found+=filter.contains(others[n]);
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << (4*items/diff.count())/1000000 << "M queries/sec (single)" << endl;
+		CHECK(found==4*falsepositives);
+	}
+	{
+		DigestCuckooFilter filter(items);
+		size_t inserted=0;
+		for(size_t n=0; n<items; n++)
+			inserted+=filter.insert(members[n]);
+		CHECK(inserted==items);
+		CHECK(filter.batchContains(items, members.data(), results.get())==items);
+		size_t falsepositives=0;
+		auto begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<4; m++)
+			falsepositives=filter.batchContains(items, others.data(), results.get());
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		double fpr=(double) falsepositives/items;
+		cout << "DigestCuckooFilter at " << 8.0*filter.memoryUsage()/items << " bits/item has a false positive rate of " << 100*fpr << "% at " << (4*items/diff.count())/1000000 << "M queries/sec (batch)" << endl;
+		CHECK(fpr<0.001);
+		size_t erased=0;
+		for(size_t n=0; n<items; n+=2)
+			erased+=filter.erase(members[n]);
+		CHECK(erased==items/2);
+		CHECK(filter.size()==items/2);
+		size_t stillfound=0;
+		for(size_t n=1; n<items; n+=2)
+			stillfound+=filter.contains(members[n]);
+		CHECK(stillfound==items/2);
+	}
+	{
+		// Serialise, map back in and merge
+		DigestBloomFilter a(1000), b(1000);
+		DigestCuckooFilter c(1000), d(1000);
+		for(size_t n=0; n<1000; n++)
+		{
+			(n&1 ? a : b).insert(members[n]);
+			(n&1 ? c : d).insert(Int256Ref(members[n]));
+		}
+		vector<Int256> buffer(a.dataSize()/sizeof(Int256));
+		memcpy((void *) buffer.data(), a.data(), a.dataSize());
+		DigestBloomFilter view((const char *) buffer.data(), a.dataSize());
+		CHECK(view.isView());
+		CHECK(view.size()==500);
+		CHECK_THROWS(view.insert(members[0]));
+		a.merge(b);
+		c.merge(d);
+		size_t found=0, viewfound=0;
+		for(size_t n=0; n<1000; n++)
+		{
+			found+=a.contains(members[n])+c.contains(members[n]);
+			viewfound+=(n&1) && view.contains(members[n]);
+		}
+		CHECK(found==2000);
+		CHECK(viewfound==500);
+		vector<Int256> cbuffer(c.dataSize()/sizeof(Int256));
+		memcpy((void *) cbuffer.data(), c.data(), c.dataSize());
+		DigestCuckooFilter cview((char *) cbuffer.data(), c.dataSize());
+		CHECK(cview.size()==1000);
+		CHECK(cview.erase(members[0]));
+		CHECK(cview.size()==999);
+		CHECK_THROWS(DigestBloomFilter((const char *) cbuffer.data(), c.dataSize()));
+	}
+}
+
+TEST_CASE("ContentChunker/works", "Tests that ContentChunker finds stable content defined boundaries and fingerprints them")
+{
+	struct Found
+	{
+		vector<std::pair<unsigned long long, size_t>> chunks;
+		vector<Hash256> hashes;
+	};
+	const size_t bytes=16*1024*1024;
+	vector<Int256> random(bytes/32+1);
+	Int256::FillFastRandom(random.data(), random.size(), 80);
+	const char *data=random.front().asBytes();
+	Found whole, streamed;
+	auto collect=[](Found &out) { return [&out](size_t no, const ContentChunker::Chunk *chunks, const Hash256 *hashes) {
+		for(size_t n=0; n<no; n++)
+		{
+			out.chunks.push_back(std::make_pair(chunks[n].offset, chunks[n].length));
+			out.hashes.push_back(hashes[n]);
+		}
+	}; };
+	{
+		ContentChunker chunker(collect(whole));
+		CHECK(chunker.process(data, bytes, true)==bytes);
+		unsigned long long offset=0;
+		size_t badlengths=0, badhashes=0;
+		for(size_t n=0; n<whole.chunks.size(); n++)
+		{
+			auto &c=whole.chunks[n];
+			badlengths+=c.first!=offset || c.second>chunker.maxSize() || (n+1<whole.chunks.size() && c.second<chunker.minSize());
+			offset+=c.second;
+			Hash256 h;
+			h.AddSHA256To(data+c.first, c.second);
+			badhashes+=h!=whole.hashes[n];
+		}
+		CHECK(offset==bytes);
+		CHECK(badlengths==0);
+		CHECK(badhashes==0);
+		auto &stats=chunker.statistics();
+		cout << "ContentChunker made " << stats.chunks << " chunks of mean " << stats.meanLength() << " stddev " << stats.stddevLength() << " bytes (min " << stats.minLength << ", max " << stats.maxLength << ")" << endl;
+		CHECK(stats.chunks==whole.chunks.size());
+		CHECK(fabs(stats.meanLength()-chunker.avgSize())<chunker.avgSize()/4);
+	}
+	{
+		// Streaming in odd sized pieces, resubmitting the unconsumed tail, must give the same chunks
+		ContentChunker chunker(collect(streamed));
+		vector<char> pending;
+		for(size_t offset=0; offset<bytes; offset+=1000003)
+		{
+			size_t piece=std::min((size_t) 1000003, bytes-offset);
+			pending.insert(pending.end(), data+offset, data+offset+piece);
+			size_t consumed=chunker.process(pending.data(), pending.size(), offset+piece==bytes);
+			pending.erase(pending.begin(), pending.begin()+consumed);
+		}
+		CHECK(pending.empty());
+		bool same=streamed.chunks==whole.chunks;
+		for(size_t n=0; same && n<whole.hashes.size(); n++)
+			same=whole.hashes[n]==streamed.hashes[n];
+		CHECK(same);
+	}
+	{
+		// Inserting bytes near the start must leave almost all later chunks unchanged
+		vector<char> shifted(data, data+bytes);
+		shifted.insert(shifted.begin()+100000, 17, 'x');
+		Found found;
+		ContentChunker chunker(collect(found));
+		chunker.process(shifted.data(), shifted.size(), true);
+		vector<Hash256> original(whole.hashes.begin(), whole.hashes.end());
+		std::sort(original.begin(), original.end());
+		size_t common=0;
+		for(auto &h : found.hashes)
+			common+=std::binary_search(original.begin(), original.end(), h);
+		cout << "After inserting 17 bytes " << common << " of " << found.hashes.size() << " chunks are unchanged" << endl;
+		size_t changed=found.hashes.size()-common;
+		CHECK(changed<=4);
+	}
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	for(auto hashtype : { ContentChunker::HashType::None, ContentChunker::HashType::FastHash, ContentChunker::HashType::SHA256 })
+	{
+		size_t chunks=0;
+		ContentChunker chunker([&chunks](size_t no, const ContentChunker::Chunk *, const Hash256 *) { chunks+=no; }, hashtype);
+		for(int n=0; n<4; n++)
+			chunker.process(data, bytes, true);
+		auto &stats=chunker.statistics();
+		cout << "ContentChunker with " << (hashtype==ContentChunker::HashType::None ? "no hashing" : hashtype==ContentChunker::HashType::FastHash ? "fast hashing" : "SHA-256 hashing") << " runs at " << stats.GBPerSec() << " GB/sec (scan " << (CPU_CYCLES_PER_SEC*stats.scanSecs)/stats.bytes << " cycles/byte, hash " << (CPU_CYCLES_PER_SEC*stats.hashSecs)/stats.bytes << " cycles/byte)" << endl;
+		CHECK(chunks==stats.chunks);
+	}
+}
+
+TEST_CASE("DigestIndex/works", "Tests that DigestIndex finds digests written by DigestIndexWriter and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	const size_t items=1<<24;
+	vector<Hash256> members(items), others(items);
+	Int256::FillFastRandom(members.data(), items, 81);
+	Int256::FillFastRandom(others.data(), items, 82);
+	{
+		DigestIndexWriter writer(items+1000);
+		writer.add(items, members.data());
+		// Duplicates are removed
+		writer.add(1000, members.data());
+		CHECK(writer.write("digestindex.idx")==items);
+	}
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		DigestIndex index("digestindex.idx");
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "DigestIndex of " << items << " digests opened in " << diff.count()*1000000 << " microseconds with " << index.fanoutBits() << " fan out bits" << endl;
+		CHECK(index.isMapped());
+		CHECK(index.size()==items);
+		bool sorted=true;
+		for(size_t n=1; sorted && n<index.size(); n++)
+			sorted=memcmp(&index[n-1], &index[n], sizeof(Int256))<0;
+		CHECK(sorted);
+		size_t found=0, misplaced=0;
+		begin=chrono::high_resolution_clock::now();
+		for(size_t n=0; n<items; n++)
+			found+=index.contains(members[n]);
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "DigestIndex finds members at " << (items/diff.count())/1000000 << "M lookups/sec (single), ";
+		CHECK(found==items);
+		for(size_t n=0; n<items; n+=97)
+		{
+			// The lower bound of a non member must be between its neighbours
+			size_t lb=index.lowerBound(others[n]);
+			misplaced+=(lb<index.size() && !(Int256Ref(index[lb])>others[n])) || (lb>0 && !(Int256Ref(index[lb-1])<others[n]));
+		}
+		CHECK(misplaced==0);
+		std::unique_ptr<bool[]> results(new bool[items]);
+		begin=chrono::high_resolution_clock::now();
+		found=index.batchContains(items, others.data(), results.get());
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << (items/diff.count())/1000000 << "M lookups/sec (batch)" << endl;
+		CHECK(found==0);
+		CHECK(index.batchContains(items, members.data(), results.get())==items);
+		DigestIndex moved(std::move(index));
+		CHECK(moved.contains(members[12345]));
+		CHECK(*moved.find(members[12345])==members[12345]);
+	}
+	std::filesystem::remove("digestindex.idx");
+	{
+		// Tiny and empty indices, and rejecting what is not an index
+		DigestIndexWriter writer;
+		CHECK(writer.write("digestindex.idx")==0);
+		DigestIndex empty("digestindex.idx");
+		CHECK(empty.empty());
+		CHECK(!empty.contains(members[0]));
+		writer.add(members[0]);
+		writer.add(members[1]);
+		CHECK(writer.write("digestindex.idx")==2);
+		DigestIndex two("digestindex.idx");
+		CHECK((two.contains(members[0]) && two.contains(members[1]) && !two.contains(members[2])));
+		vector<Int256> junk(256);
+		CHECK_THROWS(DigestIndex((const char *) junk.data(), junk.size()*sizeof(Int256)));
+	}
+	std::filesystem::remove("digestindex.idx");
+}
+
+TEST_CASE("Hamming/works", "Tests Hamming distance kernels and HammingIndex against brute force, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	const size_t items=1<<22;
+	vector<Int256> fingerprints(items);
+	Int256::FillFastRandom(fingerprints.data(), items, 83);
+	Int256 query(fingerprints[1000]);
+	// Plant near duplicates of the query at known distances
+	ranctx ctx;
+	raninit(&ctx, 84);
+	for(size_t n=0; n<64; n++)
+	{
+		Int256 &f=fingerprints[(size_t) ranval(&ctx) % items];
+		f=query;
+		for(size_t flip=0; flip<n % 24; flip++)
+			const_cast<unsigned int *>(f.asInts())[ranval(&ctx) % 8]^=1U<<(ranval(&ctx) % 32);
+	}
+	size_t wrong=0;
+	vector<unsigned short> distances(items);
+	hammingDistances(query, fingerprints.data(), items, distances.data());
+	for(size_t n=0; n<items; n+=13)
+	{
+		std::bitset<64> a(fingerprints[n].asLongLongs()[0]^query.asLongLongs()[0]), b(fingerprints[n].asLongLongs()[1]^query.asLongLongs()[1]);
+		std::bitset<64> c(fingerprints[n].asLongLongs()[2]^query.asLongLongs()[2]), d(fingerprints[n].asLongLongs()[3]^query.asLongLongs()[3]);
+		size_t expected=a.count()+b.count()+c.count()+d.count();
+		wrong+=(hamming(query, fingerprints[n])!=expected) || distances[n]!=expected;
+	}
+	CHECK(wrong==0);
+	vector<size_t> matches, expected;
+	for(size_t n=0; n<items; n++)
+		if(distances[n]<=20) expected.push_back(n);
+	CHECK(expected.size()>=32);
+	auto begin=chrono::high_resolution_clock::now();
+	for(int m=0; m<10; m++)
+	{
+		matches.clear();
+		hammingWithin(query, fingerprints.data(), items, 20, matches);
+	}
+	auto end=chrono::high_resolution_clock::now();
+	auto diff=chrono::duration_cast<secs_type>(end-begin);
+	cout << "hammingWithin scans " << items << " Int256s at " << (10*items*sizeof(Int256)/diff.count())/1000000000 << " GB/sec, " << (CPU_CYCLES_PER_SEC*diff.count())/(10*items) << " cycles/item" << endl;
+	CHECK(matches==expected);
+	{
+		// Int128 scan, which must agree with the distance kernel
+		vector<Int128> halves(items);
+		for(size_t n=0; n<items; n++)
+			halves[n]=Int128(fingerprints[n].asBytes());
+		Int128 q(query.asBytes());
+		vector<unsigned short> d(items);
+		hammingDistances(q, halves.data(), items, d.data());
+		matches.clear();
+		hammingWithin(q, halves.data(), items, 10, matches);
+		expected.clear();
+		for(size_t n=0; n<items; n++)
+			if(hamming(q, halves[n])<=10) expected.push_back(n);
+		CHECK(matches==expected);
+		wrong=0;
+		for(size_t n=0; n<items; n++)
+			wrong+=d[n]!=hamming(q, halves[n]);
+		CHECK(wrong==0);
+		HammingIndex<Int128> index;
+		index.add(items, halves.data());
+		begin=chrono::high_resolution_clock::now();
+		index.build();
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "HammingIndex<Int128> of " << items << " items built in " << diff.count() << " seconds using " << index.memoryUsage()/1024/1024 << " Mb" << endl;
+		for(unsigned maxdistance : { 3U, 7U, 11U })
+		{
+			vector<size_t> found;
+			begin=chrono::high_resolution_clock::now();
+			for(int m=0; m<10; m++)
+			{
+				found.clear();
+				index.search(q, maxdistance, found);
+			}
+			end=chrono::high_resolution_clock::now();
+			diff=chrono::duration_cast<secs_type>(end-begin);
+			matches.clear();
+			hammingWithin(q, halves.data(), items, maxdistance, matches);
+			cout << "HammingIndex<Int128> finds " << found.size() << " within " << maxdistance << " bits in " << diff.count()*1000000/10 << " microseconds" << endl;
+			CHECK(found==matches);
+		}
+		index.add(q);
+		CHECK_THROWS(index.search(q, 3, matches));
+	}
+	{
+		HammingIndex<Int256> index;
+		index.add(items, fingerprints.data());
+		index.build();
+		vector<size_t> found;
+		index.search(query, 15, found);
+		matches.clear();
+		hammingWithin(query, fingerprints.data(), items, 15, matches);
+		CHECK(found==matches);
+	}
+}
+
+TEST_CASE("Sketches/works", "Tests SimHash and MinHash sketches find near duplicate documents, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	// Make a document of 4Mb of random words, a near duplicate with one word in a hundred changed, and an unrelated one
+	ranctx ctx;
+	raninit(&ctx, 85);
+	vector<string> vocabulary(50000);
+	for(auto &w : vocabulary)
+	{
+		size_t len=1+ranval(&ctx) % 10;
+		for(size_t n=0; n<len; n++)
+			w.push_back((char)('a'+ranval(&ctx) % 26));
+	}
+	string a, b, c;
+	size_t words=0;
+	while(a.size()<4*1024*1024)
+	{
+		const string &w=vocabulary[ranval(&ctx) % vocabulary.size()];
+		const char *sep=(ranval(&ctx) % 16) ? " " : ".\n";
+		a+=w; a+=sep;
+		b+=(ranval(&ctx) % 100) ? w : vocabulary[ranval(&ctx) % vocabulary.size()]; b+=sep;
+		c+=vocabulary[ranval(&ctx) % vocabulary.size()]; c+=sep;
+		words++;
+	}
+	SimHash256 sa, sb, sc;
+	auto begin=chrono::high_resolution_clock::now();
+	sa.addText(a.data(), a.size());
+	auto end=chrono::high_resolution_clock::now();
+	auto diff=chrono::duration_cast<secs_type>(end-begin);
+	cout << "SimHash256 sketches text at " << (a.size()/diff.count())/1000000000 << " GB/sec" << endl;
+	sb.addText(b.data(), b.size());
+	sc.addText(c.data(), c.size());
+	// Every run of three words is a shingle, however the text was split into segments
+	CHECK(sa.size()==words-2);
+	unsigned near=hamming(sa.signature(), sb.signature()), far=hamming(sa.signature(), sc.signature());
+	cout << "SimHash256 distance to near duplicate is " << near << " bits, to unrelated is " << far << " bits" << endl;
+	CHECK(near<=48);
+	CHECK(far>=96);
+	{
+		SimHash128 s1, s2;
+		s1.addText(a.data(), a.size(), 4);
+		s2.addText(b.data(), b.size(), 4);
+		unsigned d=hamming(s1.signature(), s2.signature());
+		CHECK(d<=32);
+	}
+	// Sketching all the shingle hashes at once, or in parts then merging, gives the same signatures
+	vector<unsigned long long> ha, hb;
+	std::mutex lock;
+	Impl::sketch_hash_text(a.data(), a.size(), 3, [&](size_t, const unsigned long long *hashes, size_t no) { std::lock_guard<std::mutex> g(lock); ha.insert(ha.end(), hashes, hashes+no); });
+	Impl::sketch_hash_text(b.data(), b.size(), 3, [&](size_t, const unsigned long long *hashes, size_t no) { std::lock_guard<std::mutex> g(lock); hb.insert(hb.end(), hashes, hashes+no); });
+	{
+		SimHash256 s1, s2;
+		s1.addHashes(ha.size()/3, ha.data());
+		s2.addHashes(ha.size()-ha.size()/3, ha.data()+ha.size()/3);
+		s1.merge(s2);
+		CHECK(s1.signature()==sa.signature());
+	}
+	MinHash<256> ma, mb, mc, m1, m2;
+	begin=chrono::high_resolution_clock::now();
+	ma.addText(a.data(), a.size());
+	end=chrono::high_resolution_clock::now();
+	diff=chrono::duration_cast<secs_type>(end-begin);
+	cout << "MinHash<256> sketches text at " << (a.size()/diff.count())/1000000000 << " GB/sec" << endl;
+	mb.addText(b.data(), b.size());
+	mc.addText(c.data(), c.size());
+	m1.addHashes(ha.size()/2, ha.data());
+	m2.addHashes(ha.size()-ha.size()/2, ha.data()+ha.size()/2);
+	m1.merge(m2);
+	CHECK(0==memcmp(m1.signature(), ma.signature(), 256*sizeof(unsigned)));
+	// Compare with the exact Jaccard similarity of the shingle sets
+	sort(ha.begin(), ha.end());
+	ha.erase(unique(ha.begin(), ha.end()), ha.end());
+	sort(hb.begin(), hb.end());
+	hb.erase(unique(hb.begin(), hb.end()), hb.end());
+	vector<unsigned long long> common;
+	set_intersection(ha.begin(), ha.end(), hb.begin(), hb.end(), back_inserter(common));
+	double exact=(double) common.size()/(ha.size()+hb.size()-common.size()), estimate=ma.jaccard(mb);
+	double error=fabs(exact-estimate), bitestimate=MinHash<256>::bitJaccard(hamming(ma.bitSignature<Int256>(), mb.bitSignature<Int256>()), 256);
+	double biterror=fabs(exact-bitestimate), unrelated=ma.jaccard(mc);
+	cout << "MinHash<256> Jaccard exact " << exact << " estimate " << estimate << " from bit signature " << bitestimate << endl;
+	CHECK(error<0.1);
+	CHECK(biterror<0.2);
+	CHECK(unrelated<0.05);
+	{
+		// Shingles added directly, and tiny texts of fewer words than the width
+		const char *shingles[]={ "the quick", "quick brown", "brown fox" };
+		size_t lengths[]={ 9, 11, 9 };
+		MinHash<64> s1, s2, s3;
+		s1.add(3, shingles, lengths);
+		for(size_t n=0; n<3; n++)
+			s2.add(shingles[n], lengths[n]);
+		CHECK(s1.jaccard(s2)==1.0);
+		s3.addText("  hello world ", 14, 3);
+		CHECK(s3.size()==1ULL);
+		s3.clear();
+		s3.addText(" \n ", 3, 3);
+		CHECK(s3.size()==0ULL);
+	}
+	{
+		// A word hashes the same at the end of the text as in the middle, where 16 bytes can be read after it
+		const string t1="alpha beta gamma", t2=t1+"                    ";
+		vector<unsigned long long> h1, h2;
+		Impl::sketch_hash_text(t1.data(), t1.size(), 1, [&](size_t, const unsigned long long *hashes, size_t no) { h1.insert(h1.end(), hashes, hashes+no); });
+		Impl::sketch_hash_text(t2.data(), t2.size(), 1, [&](size_t, const unsigned long long *hashes, size_t no) { h2.insert(h2.end(), hashes, hashes+no); });
+		CHECK(h1.size()==3);
+		CHECK(h1==h2);
+		MinHash<64> s1, s2;
+		s1.addText(t1.data(), t1.size());
+		s2.addText(t2.data(), t2.size());
+		CHECK(s1.jaccard(s2)==1.0);
+	}
+}
+
+TEST_CASE("CountingSketches/works", "Tests the accuracy, merging, serialisation and speed of HyperLogLog and CountMinSketch")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	const size_t items=1<<23;
+	vector<Int128> keys(items);
+	Int128::FillFastRandom(keys.data(), items, 86);
+	{
+		HyperLogLog hll;
+		size_t inserted=0;
+		double worst=0;
+		for(size_t count : { (size_t) 10, (size_t) 100, (size_t) 1000, (size_t) 10000, (size_t) 100000, (size_t) 1000000, items })
+		{
+			hll.insert(count-inserted, keys.data()+inserted);
+			inserted=count;
+			double error=fabs(hll.estimate()-count)/count;
+			cout << "HyperLogLog estimates " << count << " distinct as " << hll.estimate() << (hll.isSparse() ? " (sparse)" : " (dense)") << endl;
+			if(error>worst) worst=error;
+		}
+		CHECK(worst<0.04);
+		// Inserting again changes nothing
+		vector<char> before=hll.serialise();
+		hll.insert(1000, keys.data());
+		CHECK(before==hll.serialise());
+		HyperLogLog restored(before.data(), before.size());
+		CHECK(restored.estimate()==hll.estimate());
+		CHECK(restored.serialise()==before);
+		CHECK_THROWS(HyperLogLog(before.data(), before.size()-1));
+		before[12]^=1;
+		CHECK_THROWS(HyperLogLog(before.data(), before.size()));
+		// Sparse entries whose ranks are out of range are corrupt
+		{
+			auto sparsebuffer=[](unsigned precision, unsigned entry)
+			{
+				Impl::HyperLogLogHeader h;
+				memset(&h, 0, sizeof(h));
+				memcpy(h.magic, "NEDHLLPP", 8);
+				h.version=1;
+				h.precision=precision;
+				h.sparse=1;
+				h.entries=1;
+				vector<char> ret(sizeof(h));
+				Impl::sketch_put_varint(ret, entry);
+				h.payload=ret.size()-sizeof(h);
+				memcpy(ret.data(), &h, sizeof(h));
+				return ret;
+			};
+			size_t rejected=0, accepted=0;
+			for(unsigned precision : { 4U, 14U, 18U })
+			{
+				for(unsigned rank : { 0U, 41U, 63U })
+				{
+					vector<char> corrupt=sparsebuffer(precision, (3<<6)|rank);
+					try
+					{
+						HyperLogLog(corrupt.data(), corrupt.size());
+					}
+					catch(const std::invalid_argument &)
+					{
+						rejected++;
+					}
+				}
+				for(unsigned rank : { 1U, 40U })
+				{
+					vector<char> valid=sparsebuffer(precision, (3<<6)|rank);
+					HyperLogLog restored(valid.data(), valid.size());
+					restored.makeDense();
+					accepted+=restored.estimate()>0.5 && restored.serialise().size()>sizeof(Impl::HyperLogLogHeader);
+				}
+			}
+			CHECK(rejected==9);
+			CHECK(accepted==6);
+		}
+		// Merging halves, dense or sparse, gives the same registers
+		HyperLogLog a, b;
+		a.insert(items/2, keys.data());
+		b.insert(items-items/2, keys.data()+items/2);
+		a.merge(b);
+		CHECK(a.serialise()==hll.serialise());
+		HyperLogLog c, d, e;
+		c.insert(500, keys.data());
+		d.insert(700, keys.data()+300);
+		c.merge(d);
+		e.insert(1000, keys.data());
+		CHECK(c.isSparse());
+		CHECK(c.serialise()==e.serialise());
+		vector<char> sparse=c.serialise();
+		cout << "HyperLogLog of 1000 distinct serialises to " << sparse.size() << " bytes sparse" << endl;
+		HyperLogLog f(sparse.data(), sparse.size());
+		CHECK(f.estimate()==c.estimate());
+		f.merge(a);
+		CHECK(f.serialise()==hll.serialise());
+		CHECK_THROWS(c.insertConcurrent(keys[0]));
+		CHECK_THROWS(c.merge(HyperLogLog(10)));
+		// Concurrent insertion gives the same registers as serial insertion
+		HyperLogLog concurrent(14, false);
+		vector<thread> ts;
+		for(size_t t=0; t<4; t++)
+			ts.push_back(thread([&concurrent, &keys, t, items]{ for(size_t n=t; n<items; n+=4) concurrent.insertConcurrent(keys[n]); }));
+		for(auto &t : ts) t.join();
+		CHECK(concurrent.serialise()==hll.serialise());
+		HyperLogLog timed(14, false);
+		auto begin=chrono::high_resolution_clock::now();
+		timed.insert(items, keys.data());
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "HyperLogLog dense inserts at " << diff.count()*1000000000/items << " ns/item" << endl;
+		double estimate=0;
+		begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<100; m++)
+			estimate+=timed.estimate();
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "HyperLogLog estimate() takes " << diff.count()*1000000/100 << " microseconds, merge() ";
+		begin=chrono::high_resolution_clock::now();
+		for(int m=0; m<100; m++)
+			timed.merge(hll);
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << diff.count()*1000000/100 << " microseconds" << endl;
+		CHECK(estimate>0);
+	}
+	{
+		// A skewed stream of 16M events over 64K keys, of which eight are each 2% of events
+		const size_t distinct=65536, events=1<<24;
+		vector<Int128> stream(events);
+		vector<unsigned> truth(distinct);
+		ranctx ctx;
+		raninit(&ctx, 87);
+		for(size_t n=0; n<events; n++)
+		{
+			size_t k=(ranval(&ctx) % 50)<8 ? ranval(&ctx) % 8 : ranval(&ctx) % distinct;
+			stream[n]=keys[k];
+			truth[k]++;
+		}
+		CountMinSketch cms=CountMinSketch::fromErrorBounds(0.0001, 0.01);
+		CHECK(cms.depth()==5);
+		auto begin=chrono::high_resolution_clock::now();
+		cms.insert(events, stream.data());
+		auto end=chrono::high_resolution_clock::now();
+		auto diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << "CountMinSketch of " << cms.width() << "x" << cms.depth() << " inserts at " << diff.count()*1000000000/events << " ns/item";
+		vector<unsigned> estimates(distinct);
+		begin=chrono::high_resolution_clock::now();
+		cms.estimate(distinct, keys.data(), estimates.data());
+		end=chrono::high_resolution_clock::now();
+		diff=chrono::duration_cast<secs_type>(end-begin);
+		cout << ", estimates at " << diff.count()*1000000000/distinct << " ns/item" << endl;
+		size_t under=0, beyond=0, heavyoff=0;
+		for(size_t k=0; k<distinct; k++)
+		{
+			under+=estimates[k]<truth[k];
+			beyond+=estimates[k]-truth[k]>cms.errorBound();
+			if(k<8) heavyoff+=estimates[k]-truth[k]>truth[k]/1000;
+			if(estimates[k]!=cms.estimate(keys[k])) under++;
+		}
+		CHECK(cms.total()==events);
+		CHECK(under==0);
+		CHECK(beyond<=distinct/100);
+		CHECK(heavyoff==0);
+		// Single inserts match batch inserts, and serialisation round trips
+		CountMinSketch single(cms.width(), cms.depth());
+		unsigned last=0;
+		for(size_t n=0; n<events/16; n++)
+			last=single.insert(stream[n]);
+		CHECK(last==single.estimate(stream[events/16-1]));
+		CountMinSketch batch(cms.width(), cms.depth());
+		batch.insert(events/16, stream.data());
+		CHECK(batch.serialise()==single.serialise());
+		vector<char> bytes=cms.serialise();
+		CountMinSketch restored(bytes.data(), bytes.size());
+		CHECK(restored.serialise()==bytes);
+		CHECK_THROWS(CountMinSketch(bytes.data(), 16));
+		CHECK_THROWS(restored.merge(CountMinSketch(1024)));
+		// Concurrent insertion and merging never underestimate
+		CountMinSketch concurrent(cms.width(), cms.depth());
+		vector<thread> ts;
+		for(size_t t=0; t<4; t++)
+			ts.push_back(thread([&concurrent, &stream, t, events]{ for(size_t n=t; n<events/2; n+=4) concurrent.insertConcurrent(stream[n]); }));
+		for(auto &t : ts) t.join();
+		CountMinSketch second(cms.width(), cms.depth());
+		second.insert(events-events/2, stream.data()+events/2);
+		concurrent.merge(second);
+		CHECK(concurrent.total()==events);
+		under=0;
+		for(size_t k=0; k<distinct; k++)
+			under+=concurrent.estimate(keys[k])<truth[k];
+		CHECK(under==0);
+	}
+}
+
+TEST_CASE("ConsistentHashing/works", "Tests the remapping, balance and speed of jump, rendezvous and bounded load consistent hashing")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	const size_t items=1<<18;
+	vector<Int128> keys(items);
+	Int128::FillFastRandom(keys.data(), items, 39);
+	{
+		// Growing from 100 to 101 buckets moves about 1/101 of keys, all to the new bucket
+		vector<unsigned> before(items), after(items);
+		jumpConsistentHash(items, keys.data(), 100, before.data());
+		jumpConsistentHash(items, keys.data(), 101, after.data());
+		size_t moved=0, elsewhere=0, mismatches=0;
+		vector<size_t> counts(101);
+		for(size_t n=0; n<items; n++)
+		{
+			if(before[n]!=after[n])
+			{
+				moved++;
+				if(after[n]!=100) elsewhere++;
+			}
+			if(after[n]!=jumpConsistentHash(keys[n], 101)) mismatches++;
+			counts[after[n]]++;
+		}
+		double movedfraction=double(moved)/items;
+		size_t fewest=*std::min_element(counts.begin(), counts.end()), most=*std::max_element(counts.begin(), counts.end());
+		cout << "jumpConsistentHash moved " << movedfraction*100 << "% of keys going from 100 to 101 buckets, loads " << fewest << "-" << most << endl;
+		CHECK(mismatches==0);
+		CHECK(elsewhere==0);
+		CHECK(fabs(movedfraction-1.0/101)<0.002);
+		// One bucket takes everything, and there must be at least one
+		vector<unsigned> single(items, 1);
+		jumpConsistentHash(items, keys.data(), 1, single.data());
+		CHECK(std::count(single.begin(), single.end(), 0U)==(ptrdiff_t) items);
+		CHECK(jumpConsistentHash(keys[0], 1)==0U);
+		CHECK_THROWS(jumpConsistentHash(keys[0], 0));
+		CHECK_THROWS(jumpConsistentHash(items, keys.data(), 0, single.data()));
+		CHECK(most<fewest*5/4);
+		// Results are the same in every build
+		unsigned long long checksum=0;
+		for(size_t n=0; n<items; n++) checksum=checksum*31+after[n];
+		CHECK(checksum==14585191968524042272ULL);
+	}
+	{
+		WeightedRendezvousHash router;
+		CHECK_THROWS(router.route(keys[0]));
+		CHECK_THROWS(router.add(1, 0.0));
+		for(unsigned long long id=1; id<=4; id++)
+			router.add(id*1000, (double) id);
+		vector<unsigned long long> before(items), after(items);
+		router.route(items, keys.data(), before.data());
+		size_t mismatches=0;
+		vector<size_t> counts(5);
+		for(size_t n=0; n<items; n++)
+		{
+			if(before[n]!=router.route(keys[n])) mismatches++;
+			counts[before[n]/1000]++;
+		}
+		CHECK(mismatches==0);
+		// Buckets receive keys in proportion to their weights of 1, 2, 3 and 4
+		double worst=0;
+		for(size_t id=1; id<=4; id++)
+		{
+			double error=fabs(double(counts[id])/items-id/10.0);
+			cout << "WeightedRendezvousHash bucket of weight " << id << " received " << double(counts[id])*100/items << "% of keys" << endl;
+			if(error>worst) worst=error;
+		}
+		CHECK(worst<0.01);
+		// Adding a bucket only moves keys to it, and removing it moves them back
+		router.add(5000, 2.5);
+		router.route(items, keys.data(), after.data());
+		size_t moved=0, elsewhere=0;
+		for(size_t n=0; n<items; n++)
+			if(before[n]!=after[n])
+			{
+				moved++;
+				if(after[n]!=5000) elsewhere++;
+			}
+		double movedfraction=double(moved)/items;
+		cout << "WeightedRendezvousHash moved " << movedfraction*100 << "% of keys adding a bucket of weight 2.5 to 10" << endl;
+		CHECK(elsewhere==0);
+		CHECK(fabs(movedfraction-0.2)<0.01);
+		CHECK(router.remove(5000));
+		CHECK(!router.remove(5000));
+		router.route(items, keys.data(), after.data());
+		CHECK(before==after);
+		unsigned long long checksum=0;
+		for(size_t n=0; n<items; n++) checksum=checksum*31+before[n];
+		CHECK(checksum==12800802576920830392ULL);
+	}
+	{
+		CHECK_THROWS(BoundedLoadHashRing(1.0));
+		CHECK_THROWS(BoundedLoadHashRing(1.25, 0));
+		BoundedLoadHashRing ring;
+		CHECK_THROWS(ring.lookup(keys[0]));
+		for(unsigned long long id=0; id<20; id++)
+			ring.add(id+1);
+		vector<unsigned long long> before(items), after(items);
+		ring.lookup(items, keys.data(), before.data());
+		size_t mismatches=0;
+		for(size_t n=0; n<items; n++)
+			if(before[n]!=ring.lookup(keys[n])) mismatches++;
+		CHECK(mismatches==0);
+		ring.add(100);
+		ring.lookup(items, keys.data(), after.data());
+		size_t moved=0, elsewhere=0;
+		for(size_t n=0; n<items; n++)
+			if(before[n]!=after[n])
+			{
+				moved++;
+				if(after[n]!=100) elsewhere++;
+			}
+		cout << "BoundedLoadHashRing moved " << double(moved)*100/items << "% of keys going from 20 to 21 buckets" << endl;
+		CHECK(elsewhere==0);
+		CHECK(moved>0);
+		CHECK(ring.remove(100));
+		ring.lookup(items, keys.data(), after.data());
+		CHECK(before==after);
+		// Acquiring keeps every bucket within its capacity, and releasing undoes it
+		ring.acquire(items, keys.data(), after.data());
+		unsigned long long most=0, overloaded=0;
+		for(size_t n=0; n<ring.size(); n++)
+		{
+			if(ring.load(n)>ring.capacity(n)) overloaded++;
+			if(ring.load(n)>most) most=ring.load(n);
+		}
+		unsigned long long fairshare=items/ring.size();
+		cout << "BoundedLoadHashRing acquired " << ring.totalLoad() << " keys with at most " << most << " per bucket against a fair share of " << fairshare << endl;
+		CHECK(overloaded==0ULL);
+		CHECK(ring.totalLoad()==items);
+		CHECK(most<=fairshare*5/4+1);
+		for(size_t n=0; n<items; n++)
+			ring.release(after[n]);
+		CHECK(ring.totalLoad()==0ULL);
+		CHECK(!ring.release(1));
+		CHECK(!ring.release(100));
+	}
+	for(unsigned buckets : { 10U, 100U, 1000U, 10000U })
+	{
+		vector<unsigned> jumps(items);
+		vector<unsigned long long> results(items);
+		vector<unsigned long long> ids(buckets);
+		for(unsigned n=0; n<buckets; n++) ids[n]=n;
+		WeightedRendezvousHash router;
+		BoundedLoadHashRing ring;
+		router.add(buckets, ids.data());
+		ring.add(buckets, ids.data());
+		auto begin=chrono::high_resolution_clock::now();
+		jumpConsistentHash(items, keys.data(), buckets, jumps.data());
+		auto end=chrono::high_resolution_clock::now();
+		double jumptime=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/items;
+		// Rendezvous is O(buckets) so route fewer keys
+		size_t routed=buckets>=1000 ? items/64 : items;
+		begin=chrono::high_resolution_clock::now();
+		router.route(routed, keys.data(), results.data());
+		end=chrono::high_resolution_clock::now();
+		double rendezvoustime=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/routed;
+		begin=chrono::high_resolution_clock::now();
+		ring.lookup(items, keys.data(), results.data());
+		end=chrono::high_resolution_clock::now();
+		double ringtime=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/items;
+		cout << "With " << buckets << " buckets routing costs " << jumptime << "ns/key jump, " << rendezvoustime << "ns/key rendezvous and " << ringtime << "ns/key ring" << endl;
+	}
+}
+
+// Counts the key comparisons made by hash tables, so their probe lengths can be measured
+static size_t counted_compares;
+template<class T> struct counting_equal_to
+{
+	bool operator()(const T &a, const T &b) const { counted_compares++; return a==b; }
+};
+// Returns the key comparisons per successful lookup of a Map of keys, and the time per lookup
+template<class Map> static double probe_hash_table(const vector<Int128> &keys, double &nsperlookup)
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	Map map;
+	for(size_t n=0; n<keys.size(); n++)
+		map.insert(make_pair(keys[n], n));
+	counted_compares=0;
+	size_t found=0;
+	auto begin=chrono::high_resolution_clock::now();
+	for(size_t n=0; n<keys.size(); n++)
+		found+=(map.find(keys[n])->second==n);
+	auto end=chrono::high_resolution_clock::now();
+	nsperlookup=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/keys.size();
+	return found==keys.size() ? double(counted_compares)/keys.size() : -1;
+}
+TEST_CASE("hash_selector/works", "Tests that a specialised hash_selector is used by std::hash and the containers using it")
+{
+	vector<Int256> values(1000);
+	Int256::FillFastRandom(values.data(), values.size(), 41);
+	std::unordered_set<Hash128> us;
+	FlatHashSet<Hash128> fs;
+	size_t mixed=0, truncated=0, placed=0;
+	for(size_t n=0; n<values.size(); n++)
+	{
+		Hash128 h(values[n].asBytes());
+		Hash256 h256((const char *) values[n].asLongLongs());
+		Int128 i(values[n].asBytes());
+		// Hash128 was selected above to mix, while Int128 and Hash256 keep truncating
+		mixed+=(hash<Hash128>()(h)==mixing_hash()(h) && hash<Hash128>()(h)!=h.asSize_t());
+		truncated+=(hash<Int128>()(i)==i.asSize_t() && hash<Hash256>()(h256)==h256.asSize_t());
+		us.insert(h);
+		fs.insert(h);
+	}
+	for(size_t n=0; n<values.size(); n++)
+	{
+		Hash128 h(values[n].asBytes());
+		placed+=(us.hash_function()(h)==mixing_hash()(h) && us.bucket(h)==mixing_hash()(h) % us.bucket_count() && fs.count(h)==1);
+	}
+	CHECK(mixed==values.size());
+	CHECK(truncated==values.size());
+	CHECK(placed==values.size());
+	CHECK(us.size()==values.size());
+	CHECK(fs.size()==values.size());
+}
+
+TEST_CASE("mixing_hash/works", "Tests that mixing_hash spreads structured keys which truncating_hash clusters, and how fast")
+{
+	const size_t items=1<<14;
+	{
+		// Values and their views hash identically, and std::hash truncates by default
+		vector<Int256> values(1000);
+		Int256::FillFastRandom(values.data(), values.size(), 40);
+		size_t agree=0;
+		for(size_t n=0; n<values.size(); n++)
+		{
+			Int128 half(values[n].asBytes());
+			Int256Ref ref(values[n]);
+			Int128Ref halfref(values[n].asBytes());
+			agree+=(hash<Int256>()(values[n])==values[n].asSize_t() && hash<Int128>()(half)==half.asSize_t() && hash<Int256Ref>()(ref)==hash<Int256>()(values[n])
+				&& mixing_hash()(ref)==mixing_hash()(values[n]) && mixing_hash()(halfref)==mixing_hash()(half) && truncating_hash()(halfref)==truncating_hash()(half));
+		}
+		CHECK(agree==values.size());
+		// Flipping any input bit flips half the output bits on average
+		double flips128=0, flips256=0;
+		for(size_t n=0; n<256; n++)
+		{
+			Int128 half(values[n].asBytes());
+			size_t h128=mixing_hash()(half), h256=mixing_hash()(values[n]);
+			for(size_t bit=0; bit<256; bit++)
+			{
+				char mask[32]={ 0 };
+				mask[bit/8]=(char)(1<<(bit%8));
+				if(bit<128)
+					flips128+=Impl::popcount64(h128^mixing_hash()(half^Int128(mask)));
+				flips256+=Impl::popcount64(h256^mixing_hash()(values[n]^Int256(mask)));
+			}
+		}
+		flips128/=256*128;
+		flips256/=256*256;
+		cout << "mixing_hash flips an average of " << flips128 << " bits of 64 per Int128 input bit flipped, and " << flips256 << " per Int256 input bit" << endl;
+		CHECK(fabs(flips128-32)<0.5);
+		CHECK(fabs(flips256-32)<0.5);
+	}
+	vector<Int128> randoms(items), counters(items), ipv6(items), pointers(items);
+	Int128::FillFastRandom(randoms.data(), items, 40);
+	for(size_t n=0; n<items; n++)
+	{
+		unsigned long long w[2];
+		w[0]=n; w[1]=0;
+		counters[n]=Int128((const char *) w);
+		// Hosts numbered within one /64 prefix
+		w[0]=0x20010db812345678ULL; w[1]=n+1;
+		ipv6[n]=Int128((const char *) w);
+		// Cache line aligned pointers with a few versions each
+		w[0]=0x00007f3a5c000000ULL+(n/4)*64; w[1]=n%4;
+		pointers[n]=Int128((const char *) w);
+	}
+	const char *names[]={ "random", "counter", "IPv6", "(pointer, version)" };
+	const vector<Int128> *keysets[]={ &randoms, &counters, &ipv6, &pointers };
+	double worstmixed=0, ipv6truncated=0;
+	for(size_t k=0; k<4; k++)
+	{
+		double flattime, flatmixtime, stltime, stlmixtime;
+		double flat=probe_hash_table<FlatHashMap<Int128, size_t, hash<Int128>, counting_equal_to<Int128>>>(*keysets[k], flattime);
+		double flatmix=probe_hash_table<FlatHashMap<Int128, size_t, mixing_hash, counting_equal_to<Int128>>>(*keysets[k], flatmixtime);
+		double stl=probe_hash_table<unordered_map<Int128, size_t, hash<Int128>, counting_equal_to<Int128>, aligned_allocator<pair<const Int128, size_t>, 16>>>(*keysets[k], stltime);
+		double stlmix=probe_hash_table<unordered_map<Int128, size_t, mixing_hash, counting_equal_to<Int128>, aligned_allocator<pair<const Int128, size_t>, 16>>>(*keysets[k], stlmixtime);
+		cout << "With " << names[k] << " keys FlatHashMap makes " << flat << " compares/lookup taking " << flattime << "ns truncating and " << flatmix << " taking " << flatmixtime << "ns mixing" << endl;
+		cout << "With " << names[k] << " keys unordered_map makes " << stl << " compares/lookup taking " << stltime << "ns truncating and " << stlmix << " taking " << stlmixtime << "ns mixing" << endl;
+		CHECK(flat>0);
+		CHECK(stl>0);
+		worstmixed=max(worstmixed, max(flatmix, stlmix));
+		if(2==k) ipv6truncated=min(flat, stl);
+	}
+	CHECK(worstmixed<1.5);
+	CHECK(ipv6truncated>100);
+}
+
+TEST_CASE("Arena/works", "Tests that Arena and arena_allocator allocate aligned memory, rewind scopes and overflow as asked, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	typedef arena_allocator<Hash256, 32> hash_allocator;
+	typedef arena_allocator<Int256, 32> int_allocator;
+	{
+		Arena arena(4096);
+		vector<Hash256, hash_allocator> hashes((hash_allocator(arena)));
+		size_t misaligned=0;
+		for(size_t n=0; n<1000; n++)
+		{
+			hashes.push_back(Hash256());
+			misaligned+=((size_t) hashes.data() & 31)!=0;
+		}
+		CHECK(misaligned==0);
+		CHECK(arena.capacity()>4096);
+		// Scopes nest, rewinding what was allocated within them including chunks of their own
+		size_t before=arena.used();
+		{
+			ArenaScope outer(arena);
+			void *a=arena.allocate(100, 64);
+			CHECK(((size_t) a & 63)==0);
+			size_t middle=arena.used();
+			{
+				ArenaScope inner(arena);
+				void *b=arena.allocate(10000, 128);
+				CHECK(((size_t) b & 127)==0);
+				CHECK(arena.owns(b));
+			}
+			CHECK(arena.used()==middle);
+		}
+		CHECK(arena.used()==before);
+		// The most recent block returns to the arena
+		void *p=arena.allocate(256, 32);
+		arena.deallocate(p, 256);
+		CHECK(arena.allocate(256, 32)==p);
+		CHECK_THROWS(arena.allocate(8, 3));
+		hashes.clear();
+		hashes.shrink_to_fit();
+		size_t capacity=arena.capacity();
+		arena.reset();
+		CHECK(arena.used()==0);
+		CHECK(arena.capacity()==capacity);
+		arena.release();
+		CHECK(arena.capacity()==4096);
+	}
+	{
+		// A buffer on the stack falls back to upstream allocation per block
+		TYPEALIGNMENT(32) char buffer[1024];
+		Arena arena(buffer, sizeof(buffer));
+		{
+			vector<Int256, int_allocator> ints((int_allocator(arena)));
+			ints.reserve(16);
+			CHECK(arena.owns(ints.data()));
+			ints.reserve(1000);
+			CHECK(!arena.owns(ints.data()));
+			CHECK(arena.upstreamBlocks()==1);
+			CHECK(((size_t) ints.data() & 31)==0);
+		}
+		CHECK(arena.upstreamBlocks()==0);
+		Arena strict(buffer, sizeof(buffer), ArenaOverflow::Throw);
+		strict.allocate(1000);
+		CHECK_THROWS(strict.allocate(100));
+	}
+	{
+		// Node containers rebind the allocator and stay aligned
+		Arena a, b;
+		arena_allocator<Int128, 16> x(a), y(a), z(b);
+		CHECK(x==y);
+		CHECK(x!=z);
+		list<Int128, arena_allocator<Int128, 16>> nodes(x);
+		size_t misaligned=0;
+		for(size_t n=0; n<100; n++)
+		{
+			nodes.push_back(Int128());
+			misaligned+=((size_t) &nodes.back() & 15)!=0;
+		}
+		CHECK(misaligned==0);
+		CHECK(a.used()>=100*sizeof(Int128));
+	}
+	const size_t iterations=100000;
+	size_t foo=0;
+	auto begin=chrono::high_resolution_clock::now();
+	for(size_t n=0; n<iterations; n++)
+	{
+		vector<Int256, aligned_allocator<Int256, 32>> scratch(32);
+		foo+=(size_t) scratch.data();
+	}
+	auto end=chrono::high_resolution_clock::now();
+	double alignedtime=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/iterations;
+	Arena arena;
+	begin=chrono::high_resolution_clock::now();
+	for(size_t n=0; n<iterations; n++)
+	{
+		ArenaScope scope(arena);
+		vector<Int256, int_allocator> scratch(32, Int256(), int_allocator(arena));
+		foo+=(size_t) scratch.data();
+	}
+	end=chrono::high_resolution_clock::now();
+	double arenatime=chrono::duration_cast<secs_type>(end-begin).count()*1000000000/iterations;
+	cout << "Allocating and dropping a vector of 32 Int256 takes " << alignedtime << "ns with aligned_allocator and " << arenatime << "ns with arena_allocator " << (foo & 1) << endl;
+}
+
+TEST_CASE("PoolAllocator/works", "Tests that pool_allocator allocates aligned distinct blocks, reuses blocks freed by other threads, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	{
+		// Every size up to the largest class is aligned as asked and blocks never overlap
+		vector<pair<char *, pair<size_t, size_t>>> blocks;
+		size_t misaligned=0;
+		for(size_t size=1; size<=2100; size+=7)
+		{
+			char *a=pool_allocator<char, 8>().allocate(size), *b=pool_allocator<char, 16>().allocate(size), *c=pool_allocator<char, 32>().allocate(size), *d=pool_allocator<char, 64>().allocate(size);
+			misaligned+=((size_t) a & 7)!=0 || ((size_t) b & 15)!=0 || ((size_t) c & 31)!=0 || ((size_t) d & 63)!=0;
+			blocks.push_back(make_pair(a, make_pair(size, (size_t) 8)));
+			blocks.push_back(make_pair(b, make_pair(size, (size_t) 16)));
+			blocks.push_back(make_pair(c, make_pair(size, (size_t) 32)));
+			blocks.push_back(make_pair(d, make_pair(size, (size_t) 64)));
+			memset(a, 1, size); memset(b, 2, size); memset(c, 3, size); memset(d, 4, size);
+		}
+		CHECK(misaligned==0);
+		sort(blocks.begin(), blocks.end());
+		size_t overlaps=0;
+		for(size_t n=1; n<blocks.size(); n++)
+			overlaps+=blocks[n-1].first+blocks[n-1].second.first>blocks[n].first;
+		CHECK(overlaps==0);
+		for(size_t n=0; n<blocks.size(); n++)
+			Impl::pool_deallocate(blocks[n].first, blocks[n].second.first, blocks[n].second.second);
+	}
+	{
+		list<Int256, pool_allocator<Int256, 32>> nodes;
+		vector<Int256> values(10000);
+		Int256::FillFastRandom(values);
+		size_t misaligned=0;
+		for(size_t n=0; n<values.size(); n++)
+		{
+			nodes.push_back(values[n]);
+			misaligned+=((size_t) &nodes.back() & 31)!=0;
+		}
+		CHECK(misaligned==0);
+		CHECK(equal(nodes.begin(), nodes.end(), values.begin()));
+		CHECK((pool_allocator<Int256, 32>()==pool_allocator<Int128, 32>()));
+		CHECK((pool_allocator<Int256, 32>()!=pool_allocator<Int256, 64>()));
+	}
+	{
+		// Blocks allocated by one thread and freed by another are reused via the transfer lists
+		const size_t items=100000;
+		typedef pool_allocator<Int256, 32> allocator;
+		vector<Int256 *> blocks(items);
+		for(size_t n=0; n<items; n++)
+			blocks[n]=allocator().allocate(2);
+		size_t reserved=allocator::reserved();
+		thread([&blocks, items]{ for(size_t n=0; n<items; n++) allocator().deallocate(blocks[n], 2); }).join();
+		for(size_t n=0; n<items; n++)
+			blocks[n]=allocator().allocate(2);
+		cout << "pool_allocator reserved " << reserved << " bytes for " << items << " blocks of 64 bytes, and " << allocator::reserved()-reserved << " more after another thread freed them" << endl;
+		size_t grown=allocator::reserved()-reserved;
+		CHECK(grown<=65536);
+		for(size_t n=0; n<items; n++)
+			allocator().deallocate(blocks[n], 2);
+	}
+	for(size_t threads=1; threads<=64; threads*=4)
+	{
+		const size_t rounds=(1<<16)/threads, live=64;
+		double times[2];
+		for(int pool=0; pool<2; pool++)
+		{
+			vector<thread> ts;
+			auto begin=chrono::high_resolution_clock::now();
+			for(size_t t=0; t<threads; t++)
+				ts.push_back(thread([pool, rounds, live]{
+					Int256 *blocks[64];
+					for(size_t r=0; r<rounds; r++)
+					{
+						for(size_t n=0; n<live; n++)
+							blocks[n]=pool ? pool_allocator<Int256, 32>().allocate(2) : aligned_allocator<Int256, 32>().allocate(2);
+						for(size_t n=0; n<live; n++)
+							if(pool) pool_allocator<Int256, 32>().deallocate(blocks[n], 2); else aligned_allocator<Int256, 32>().deallocate(blocks[n], 2);
+					}
+				}));
+			for(auto &t : ts) t.join();
+			auto end=chrono::high_resolution_clock::now();
+			times[pool]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		double ops=double(rounds*threads*live);
+		cout << "With " << threads << " threads allocating and freeing 64 byte blocks aligned_allocator does " << ops/times[0]/1000000 << " M/sec and pool_allocator " << ops/times[1]/1000000 << " M/sec" << endl;
+	}
+}
+
+TEST_CASE("HugePageAllocator/works", "Tests that hugepage_allocator maps large allocations in aligned huge pages, falls back cleanly, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	{
+		// Below the threshold allocation is as aligned_allocator
+		vector<Int256, hugepage_allocator<Int256, 32>> small(1000);
+		CHECK(((size_t) small.data() & 31)==0);
+		CHECK(hugepage_allocator<Int256>::hugePageBytes(small.data(), small.size())==0);
+		CHECK((hugepage_allocator<Int256, 32>()==hugepage_allocator<Int128, 32>()));
+		CHECK((hugepage_allocator<Int256, 32>()!=hugepage_allocator<Int256, 64>()));
+	}
+	{
+		// Above it allocations are huge page aligned, and the Reserved policy falls back if there is no reserved pool
+		const size_t items=(64*1024*1024+1000)/sizeof(Int256);
+		vector<Int256, hugepage_allocator<Int256, 32>> transparent(items);
+		vector<Int256, hugepage_allocator<Int256, 32, 16*1024*1024, HugePagePolicy::Reserved>> reserved(items);
+		CHECK(((size_t) transparent.data() & (Impl::hugepage_size-1))==0);
+		CHECK(((size_t) reserved.data() & (Impl::hugepage_size-1))==0);
+		Int256::FillFastRandom(transparent.data(), items, 91);
+		memcpy((void *) reserved.data(), transparent.data(), items*sizeof(Int256));
+		CHECK(equal(transparent.begin(), transparent.end(), reserved.begin()));
+		size_t hugebytes=hugepage_allocator<Int256, 32>::hugePageBytes(transparent.data(), items);
+		size_t reservedbytes=hugepage_allocator<Int256, 32, 16*1024*1024, HugePagePolicy::Reserved>::hugePageBytes(reserved.data(), items);
+		cout << dec << "Of " << items*sizeof(Int256) << " bytes, " << hugebytes << " are backed by transparent huge pages and " << reservedbytes << " by reserved huge pages or failing those transparent ones" << endl;
+		CHECK(hugebytes<=items*sizeof(Int256));
+		CHECK(reservedbytes<=items*sizeof(Int256));
+	}
+	{
+		// Random lookups into a large table are TLB bound
+		const size_t items=1<<24, lookups=1<<24;
+		vector<size_t> indices(lookups);
+		{
+			vector<Int128> randoms(lookups/2);
+			Int128::FillFastRandom(randoms.data(), randoms.size(), 92);
+			memcpy(indices.data(), randoms.data(), lookups*sizeof(size_t));
+			for(auto &i : indices) i&=items-1;
+		}
+		double times[2];
+		unsigned long long sums[2];
+		{
+			vector<Hash256, aligned_allocator<Hash256, 32>> hashes(items);
+			Int256::FillFastRandom(hashes.data(), items, 93);
+			auto begin=chrono::high_resolution_clock::now();
+			unsigned long long sum=0;
+			for(size_t n=0; n<lookups; n++)
+				sum+=hashes[indices[n]].asLongLongs()[1];
+			auto end=chrono::high_resolution_clock::now();
+			times[0]=chrono::duration_cast<secs_type>(end-begin).count();
+			sums[0]=sum;
+		}
+		{
+			vector<Hash256, hugepage_allocator<Hash256, 32>> hashes(items);
+			Int256::FillFastRandom(hashes.data(), items, 93);
+			auto begin=chrono::high_resolution_clock::now();
+			unsigned long long sum=0;
+			for(size_t n=0; n<lookups; n++)
+				sum+=hashes[indices[n]].asLongLongs()[1];
+			auto end=chrono::high_resolution_clock::now();
+			times[1]=chrono::duration_cast<secs_type>(end-begin).count();
+			sums[1]=sum;
+			cout << hugepage_allocator<Hash256, 32>::hugePageBytes(hashes.data(), items) << " of " << items*sizeof(Hash256) << " bytes backed by huge pages" << endl;
+		}
+		CHECK(sums[0]==sums[1]);
+		cout << "Random lookups into " << items*sizeof(Hash256)/1024/1024 << "Mb of Hash256 take " << times[0]*1000000000/lookups << "ns with aligned_allocator and " << times[1]*1000000000/lookups << "ns with hugepage_allocator" << endl;
+	}
+}
+
+// Counts its copies and moves
+struct counted_item
+{
+	static size_t copies;
+	size_t value;
+	counted_item(size_t v=0) : value(v) { }
+	counted_item(const counted_item &o) : value(o.value) { copies++; }
+	counted_item(counted_item &&o) noexcept : value(o.value) { copies++; }
+	counted_item &operator=(const counted_item &o) { value=o.value; return *this; }
+};
+size_t counted_item::copies;
+struct relocatable_counted_item : counted_item
+{
+	relocatable_counted_item(size_t v=0) : counted_item(v) { }
+};
+namespace NiallsCPP11Utilities {
+	template<> struct is_trivially_relocatable<relocatable_counted_item> : std::true_type { };
+}
+struct throwing_counted_item
+{
+	static size_t live, throwat;
+	throwing_counted_item() { ++live; }
+	throwing_counted_item(const throwing_counted_item &) { if(!--throwat) throw std::runtime_error("copy failed"); ++live; }
+	~throwing_counted_item() { --live; }
+};
+size_t throwing_counted_item::live, throwing_counted_item::throwat;
+TEST_CASE("RemappableVector/works", "Tests that remappable_vector grows by remapping without copying relocatable items, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	{
+		// Small vectors come from the allocator, large ones are mapped, and contents survive each transition
+		remappable_vector<Int256, 32> v;
+		vector<Int256> values(100000);
+		Int256::FillFastRandom(values);
+		for(size_t n=0; n<1000; n++)
+			v.push_back(values[n]);
+		CHECK(!v.mapped());
+		CHECK(((size_t) v.data() & 31)==0);
+		for(size_t n=1000; n<values.size(); n++)
+			v.push_back(values[n]);
+		CHECK(v.mapped());
+		CHECK(v.size()==values.size());
+		CHECK(equal(v.begin(), v.end(), values.begin()));
+		v.resize(10);
+		v.shrink_to_fit();
+		CHECK(!v.mapped());
+		CHECK(equal(v.begin(), v.end(), values.begin()));
+		remappable_vector<Int256, 32> w(v);
+		v.clear();
+		CHECK(v.empty());
+		v=std::move(w);
+		CHECK(v.size()==10);
+		CHECK(equal(v.begin(), v.end(), values.begin()));
+	}
+	{
+		// A copy which throws destroys the items already copied
+		remappable_vector<throwing_counted_item> v(100);
+		throwing_counted_item::throwat=50;
+		bool threw=false;
+		try { remappable_vector<throwing_counted_item> w(v); } catch(const std::runtime_error &) { threw=true; }
+		size_t live=throwing_counted_item::live;
+		CHECK(threw);
+		CHECK(live==100);
+		throwing_counted_item::throwat=0;
+	}
+	{
+		// Relocatable items are never copied when growing, other items are moved
+		const size_t items=1<<20;
+		remappable_vector<relocatable_counted_item> relocatable;
+		remappable_vector<counted_item> other;
+		counted_item::copies=0;
+		for(size_t n=0; n<items; n++)
+			relocatable.emplace_back(n);
+		size_t relocatablecopies=counted_item::copies;
+		counted_item::copies=0;
+		for(size_t n=0; n<items; n++)
+			other.emplace_back(n);
+		size_t othercopies=counted_item::copies;
+		cout << "Growing to " << items << " items copied relocatable items " << relocatablecopies << " times and other items " << othercopies << " times" << endl;
+		CHECK(relocatablecopies==0);
+		size_t wrong=0;
+		for(size_t n=0; n<items; n++)
+			wrong+=relocatable[n].value!=n || other[n].value!=n;
+		CHECK(wrong==0);
+	}
+	{
+		const size_t items=1<<24;
+		vector<Int256> values(1<<16);
+		Int256::FillFastRandom(values);
+		double times[2];
+		{
+			auto begin=chrono::high_resolution_clock::now();
+			vector<Int256, aligned_allocator<Int256, 32>> v;
+			for(size_t n=0; n<items; n++)
+				v.push_back(values[n & 0xffff]);
+			auto end=chrono::high_resolution_clock::now();
+			times[0]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		{
+			auto begin=chrono::high_resolution_clock::now();
+			remappable_vector<Int256, 32> v;
+			for(size_t n=0; n<items; n++)
+				v.push_back(values[n & 0xffff]);
+			auto end=chrono::high_resolution_clock::now();
+			times[1]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		cout << "Growing to " << items << " Int256 by push_back takes " << times[0] << " secs with std::vector and " << times[1] << " secs with remappable_vector" << endl;
+	}
+}
+
+TEST_CASE("SmallAlignedVector/works", "Tests that small_aligned_vector behaves as std::vector, keeps short lists inline and aligned, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	vector<Hash256> values(1<<16);
+	Int256::FillFastRandom(values.data(), values.size(), 101);
+	{
+		// Short lists are inline, longer ones spill and come back on shrink_to_fit
+		small_aligned_vector<Hash256, 4, 32> v;
+		CHECK(((size_t) &v & 31)==0);
+		CHECK(v.is_inline());
+		for(size_t n=0; n<4; n++)
+			v.push_back(values[n]);
+		CHECK(v.is_inline());
+		CHECK(((size_t) v.data() & 31)==0);
+		v.push_back(values[4]);
+		CHECK(!v.is_inline());
+		CHECK(((size_t) v.data() & 31)==0);
+		v.erase(v.begin()+1, v.end());
+		v.shrink_to_fit();
+		CHECK(v.is_inline());
+		CHECK(v.front()==values[0]);
+		small_aligned_vector<int, 2> w={ 1, 2, 3 };
+		small_aligned_vector<int, 2> x(w.rbegin(), w.rend());
+		CHECK(w.size()==3);
+		CHECK(x[0]==3);
+		CHECK(w<x);
+		swap(w, x);
+		CHECK(w[0]==3);
+		CHECK((x==small_aligned_vector<int, 2>{ 1, 2, 3 }));
+	}
+	{
+		// Random operations give the same results as std::vector
+		typedef small_aligned_vector<Int256, 4, 32> small_vector;
+		// Its inline storage is 32 byte aligned, so the vector holding it must be too
+		vector<small_vector, aligned_allocator<small_vector, 32>> smalls(8);
+		vector<vector<Int256, aligned_allocator<Int256, 32>>> stds(8);
+		size_t misaligned=0, mismatches=0;
+		for(size_t i=0; i<smalls.size(); i++)
+			misaligned+=((size_t) &smalls[i] & 31)!=0 || ((size_t) smalls[i].data() & 31)!=0;
+		CHECK(misaligned==0);
+		for(size_t n=0; n<100000; n++)
+		{
+			const Int256 &value=values[n & 0xffff];
+			size_t which=value.asLongLongs()[0] % smalls.size(), op=(size_t) (value.asLongLongs()[1] % 11);
+			small_vector &s=smalls[which];
+			auto &d=stds[which];
+			size_t pos=s.empty() ? 0 : (size_t) (value.asLongLongs()[2] % s.size());
+			switch(op)
+			{
+			case 0: case 1: case 2: s.push_back(value); d.push_back(value); break;
+			case 3: s.insert(s.begin()+pos, value); d.insert(d.begin()+pos, value); break;
+			case 4: if(!s.empty()) { s.erase(s.begin()+pos); d.erase(d.begin()+pos); } break;
+			case 5: if(!s.empty()) { s.insert(s.begin()+pos, 3, s.back()); d.insert(d.begin()+pos, 3, d.back()); } break;
+			case 6: s.resize(pos/2); d.resize(pos/2); break;
+			case 7: s.shrink_to_fit(); d.shrink_to_fit(); break;
+			case 8: smalls[(which+1) % smalls.size()]=s; stds[(which+1) % stds.size()]=d; break;
+			case 9: smalls[(which+1) % smalls.size()]=std::move(s); stds[(which+1) % stds.size()]=std::move(d); s.clear(); d.clear(); break;
+			case 10: s.swap(smalls[(which+1) % smalls.size()]); d.swap(stds[(which+1) % stds.size()]); break;
+			}
+			for(size_t i=0; i<smalls.size(); i++)
+				mismatches+=smalls[i].size()!=stds[i].size() || !equal(smalls[i].begin(), smalls[i].end(), stds[i].begin());
+		}
+		CHECK(mismatches==0);
+	}
+	{
+		const size_t lists=1<<20;
+		double times[2];
+		unsigned long long sums[2]={ 0, 0 };
+		{
+			auto begin=chrono::high_resolution_clock::now();
+			for(size_t n=0; n<lists; n++)
+			{
+				vector<Hash256, aligned_allocator<Hash256, 32>> v;
+				for(size_t i=0; i<4; i++)
+					v.push_back(values[(n+i) & 0xffff]);
+				sums[0]+=v[n & 3].asLongLongs()[0];
+			}
+			auto end=chrono::high_resolution_clock::now();
+			times[0]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		{
+			auto begin=chrono::high_resolution_clock::now();
+			for(size_t n=0; n<lists; n++)
+			{
+				small_aligned_vector<Hash256, 8, 32> v;
+				for(size_t i=0; i<4; i++)
+					v.push_back(values[(n+i) & 0xffff]);
+				sums[1]+=v[n & 3].asLongLongs()[0];
+			}
+			auto end=chrono::high_resolution_clock::now();
+			times[1]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		CHECK(sums[0]==sums[1]);
+		cout << "Creating and destroying a list of four Hash256 takes " << times[0]*1000000000/lists << "ns with std::vector and " << times[1]*1000000000/lists << "ns with small_aligned_vector" << endl;
+	}
+}
+
+TEST_CASE("PerCpu/works", "Tests that CacheLinePadded pads and aligns, that ShardedCounter counts exactly, and how fast")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	{
+		CHECK(sizeof(PadSizeToMultipleOf<Int128, 64>)==64);
+		CHECK(sizeof(PadSizeToMultipleOf<Int256, 32>)==32);
+		CHECK(sizeof(CacheLinePadded<std::atomic<int>>)==CACHELINESIZE);
+		CHECK(std::alignment_of<CacheLinePadded<std::atomic<int>>>::value==CACHELINESIZE);
+		PerCpu<std::atomic<int>> slots;
+		size_t misaligned=0, nonzero=0;
+		for(size_t n=0; n<slots.size(); n++)
+		{
+			misaligned+=((size_t) &slots[n] & (CACHELINESIZE-1))!=0;
+			nonzero+=slots[n].load()!=0;
+		}
+		CHECK(misaligned==0);
+		CHECK(nonzero==0);
+		slots.local()++;
+		CHECK(slots.combine(0, [](int a, const std::atomic<int> &b) { return a+b.load(); })==1);
+	}
+	for(size_t threads=1; threads<=64; threads*=4)
+	{
+		const size_t increments=(1<<24)/threads;
+		double times[2];
+		std::atomic<long long> single(0);
+		ShardedCounter sharded;
+		for(int shard=0; shard<2; shard++)
+		{
+			vector<thread> ts;
+			auto begin=chrono::high_resolution_clock::now();
+			for(size_t t=0; t<threads; t++)
+				ts.push_back(thread([shard, increments, &single, &sharded]{
+					for(size_t n=0; n<increments; n++)
+						if(shard) ++sharded; else single.fetch_add(1, std::memory_order_relaxed);
+				}));
+			for(auto &t : ts) t.join();
+			auto end=chrono::high_resolution_clock::now();
+			times[shard]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		long long expected=(long long)(increments*threads), total=sharded.load();
+		CHECK(single.load()==expected);
+		CHECK(total==expected);
+		double ops=double(increments*threads);
+		cout << "With " << threads << " threads incrementing a std::atomic takes " << times[0]*1000000000/ops << "ns and a ShardedCounter " << times[1]*1000000000/ops << "ns" << endl;
+		sharded.reset();
+		total=sharded.load();
+		CHECK(total==0);
+	}
+}
+
+struct tracking_vector_tag { };
+struct tracking_list_tag { };
+TEST_CASE("TrackingAllocator/works", "Tests that tracking_allocator counts allocations per tag and across threads, and how much it costs")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	typedef tracking_allocator<aligned_allocator<Hash256, 32>, tracking_vector_tag> vector_allocator;
+	typedef tracking_allocator<aligned_allocator<Int256, 32>, tracking_list_tag> list_allocator;
+	{
+		vector<Hash256, vector_allocator> hashes;
+		for(size_t n=0; n<1000; n++)
+			hashes.push_back(Hash256());
+		TrackingSnapshot s=vector_allocator::snapshot();
+		long long capacitybytes=(long long)(hashes.capacity()*sizeof(Hash256));
+		CHECK(s.bytes==capacitybytes);
+		CHECK(s.live==1);
+		CHECK(s.allocations>=10);
+		CHECK(s.peakbytes>=s.bytes);
+		cout << "After 1000 push_backs into a vector of Hash256:" << endl << TextDump(s);
+		// Other tags are counted separately
+		TrackingSnapshot l=list_allocator::snapshot();
+		CHECK(l.allocations==0);
+	}
+	{
+		TrackingSnapshot s=vector_allocator::snapshot();
+		CHECK(s.bytes==0);
+		CHECK(s.live==0);
+		vector_allocator::reset();
+		s=vector_allocator::snapshot();
+		CHECK(s.allocations==0);
+		CHECK(s.peakbytes==0);
+	}
+	{
+		// Rebound node allocations are counted, including those freed by other threads than allocated them
+		list<Int256, list_allocator> nodes;
+		vector<thread> ts;
+		std::mutex lock;
+		for(size_t t=0; t<8; t++)
+			ts.push_back(thread([&nodes, &lock]{
+				list<Int256, list_allocator> mine(1000);
+				std::lock_guard<std::mutex> g(lock);
+				nodes.splice(nodes.end(), mine);
+			}));
+		for(auto &t : ts) t.join();
+		TrackingSnapshot s=list_allocator::snapshot();
+		CHECK(s.live==8000);
+		CHECK(s.allocations==8000);
+		nodes.clear();
+		s=list_allocator::snapshot();
+		CHECK(s.live==0);
+		CHECK(s.bytes==0);
+		CHECK(s.peakbytes>0);
+	}
+	{
+		const size_t rounds=1<<16, live=64;
+		double times[2];
+		for(int tracking=0; tracking<2; tracking++)
+		{
+			auto begin=chrono::high_resolution_clock::now();
+			Int256 *blocks[64];
+			for(size_t r=0; r<rounds; r++)
+			{
+				for(size_t n=0; n<live; n++)
+					blocks[n]=tracking ? list_allocator().allocate(2) : aligned_allocator<Int256, 32>().allocate(2);
+				for(size_t n=0; n<live; n++)
+					if(tracking) list_allocator().deallocate(blocks[n], 2); else aligned_allocator<Int256, 32>().deallocate(blocks[n], 2);
+			}
+			auto end=chrono::high_resolution_clock::now();
+			times[tracking]=chrono::duration_cast<secs_type>(end-begin).count();
+		}
+		double ops=double(rounds*live);
+		cout << "Allocating and freeing 64 bytes takes " << times[0]*1000000000/ops << "ns with aligned_allocator and " << times[1]*1000000000/ops << "ns with tracking_allocator, " << (times[1]/times[0]-1)*100 << "% more" << endl;
+	}
+}
+
+TEST_CASE("StlAllocatorOverride/works", "Tests that the standard containers of Int128 and Int256 allocate aligned storage")
+{
+	CHECK((std::is_same<std::vector<Int256>::allocator_type, aligned_allocator<Int256>>::value));
+	CHECK((std::is_same<std::deque<Int256>::allocator_type, pool_allocator<Int256>>::value));
+	CHECK((std::is_same<std::list<Hash256>::allocator_type, pool_allocator<Hash256>>::value));
+	CHECK((std::is_same<std::map<Hash128, int>::allocator_type, pool_allocator<pair<const Hash128, int>>>::value));
+	CHECK((std::is_same<std::unordered_map<Hash256, string>::allocator_type, pool_allocator<pair<const Hash256, string>>>::value));
+	vector<Int256> values(1000);
+	Int256::FillFastRandom(values);
+	size_t misaligned=0;
+	std::deque<Int256> d;
+	std::list<Int256> l;
+	std::forward_list<Int256> f;
+	std::set<Int256> s;
+	std::multimap<Int256, int> mm;
+	std::unordered_set<Int256> us;
+	std::unordered_map<Hash256, int> um;
+	std::unordered_map<Int128, int> um128;
+	for(size_t n=0; n<values.size(); n++)
+	{
+		d.push_front(values[n]);
+		l.push_back(values[n]);
+		f.push_front(values[n]);
+		misaligned+=((size_t) &d.front() & 31)!=0;
+		misaligned+=((size_t) &l.back() & 31)!=0;
+		misaligned+=((size_t) &f.front() & 31)!=0;
+		misaligned+=((size_t) &*s.insert(values[n]).first & 31)!=0;
+		misaligned+=((size_t) &mm.insert(make_pair(values[n], (int) n))->first & 31)!=0;
+		misaligned+=((size_t) &*us.insert(values[n]).first & 31)!=0;
+		misaligned+=((size_t) &um.insert(make_pair(Hash256((const char *) values[n].asLongLongs()), (int) n)).first->first & 31)!=0;
+		misaligned+=((size_t) &um128.insert(make_pair(Int128((const char *) values[n].asLongLongs()), (int) n)).first->first & 15)!=0;
+	}
+	CHECK(misaligned==0);
+	CHECK(s.size()==values.size());
+	CHECK(us.size()==values.size());
+	// Copies, moves and initialiser lists behave as the unspecialised containers
+	std::vector<Int256> a(values.begin(), values.end()), b;
+	b=a;
+	CHECK(b==a);
+	std::list<Int256> c={ values[0], values[1] }, e;
+	e=std::move(c);
+	CHECK(e.size()==2);
+	std::unordered_map<Hash256, int> um2=um;
+	CHECK(um2.size()==um.size());
+}
+
+struct parallel_init_item
+{
+	static std::atomic<size_t> live, throwat;
+	size_t value;
+	parallel_init_item(size_t v) : value(v) { ++live; }
+	parallel_init_item(const parallel_init_item &o) : value(o.value) { if(!--throwat) throw std::runtime_error("copy failed"); ++live; }
+	~parallel_init_item() { --live; }
+};
+std::atomic<size_t> parallel_init_item::live, parallel_init_item::throwat;
+
+TEST_CASE("ParallelInit/works", "Tests that parallel_fill_random and parallel_uninitialized_fill work")
+{
+	typedef std::chrono::duration<double, ratio<1>> secs_type;
+	typedef std::vector<Int256, default_init_allocator<aligned_allocator<Int256, 32>>> uninit_vector;
+	static_assert(leave_uninitialised<Int256>::value, "Int256 should be left uninitialised");
+	static_assert(!leave_uninitialised<Hash256>::value, "Hash256 should be initialised");
+	const size_t items=1<<24;
+	double times[2];
+	{
+		auto begin=chrono::high_resolution_clock::now();
+		vector<Int256> a(items);
+		Int256::FillFastRandom(a.data(), a.size(), 78);
+		auto end=chrono::high_resolution_clock::now();
+		times[0]=chrono::duration_cast<secs_type>(end-begin).count();
+		begin=chrono::high_resolution_clock::now();
+		uninit_vector b(items);
+		parallel_fill_random(b.data(), b.data()+b.size(), 78);
+		end=chrono::high_resolution_clock::now();
+		times[1]=chrono::duration_cast<secs_type>(end-begin).count();
+		bool same=!memcmp(a.data(), b.data(), items*sizeof(Int256));
+		CHECK(same);
+		bool aligned=((size_t) b.data() & 31)==0;
+		CHECK(aligned);
+		// resize() leaves the new items uninitialised too, but emplace_back() with arguments still constructs
+		b.resize(items+1);
+		b.emplace_back(a[0]);
+		CHECK(b.back()==a[0]);
+	}
+	cout << dec << "Constructing and randomly filling " << items << " Int256 took " << times[0] << " seconds with std::vector and " << times[1] << " seconds uninitialised and in parallel" << endl;
+
+	aligned_allocator<parallel_init_item, 64> allocator;
+	const size_t no=(4<<20)/sizeof(parallel_init_item);
+	parallel_init_item *items2=allocator.allocate(no), value(5);
+	parallel_init_item::live=1;
+	parallel_init_item::throwat=0;
+	parallel_uninitialized_fill(items2, items2+no, value);
+	size_t wrong=0;
+	for(size_t n=0; n<no; n++)
+		wrong+=items2[n].value!=5;
+	size_t live=parallel_init_item::live;
+	CHECK(wrong==0);
+	CHECK(live==no+1);
+	for(size_t n=0; n<no; n++)
+		items2[n].~parallel_init_item();
+	// A throwing copy destroys everything constructed and rethrows
+	parallel_init_item::throwat=no/2;
+	bool threw=false;
+	try { parallel_uninitialized_fill(items2, items2+no, value); } catch(const std::runtime_error &) { threw=true; }
+	live=parallel_init_item::live;
+	CHECK(threw);
+	CHECK(live==1);
+	allocator.deallocate(items2, no);
+}
+
+TEST_CASE("MemcheckAnnotations/works", "Tests that the pooled allocators mark memory they have not handed out as inaccessible to AddressSanitizer")
+{
+#if NIALLSCPP11UTILITIES_MEMCHECK && NIALLSCPP11UTILITIES_ASAN
+	pool_allocator<char, 16> pool;
+	char *a=pool.allocate(40), *b=pool.allocate(64);
+	bool open=!__asan_region_is_poisoned(a, 40), slack=!!__asan_address_is_poisoned(a+40);
+	CHECK(open);
+	CHECK(slack);
+	pool.deallocate(a, 40);
+	bool freed=!!__asan_address_is_poisoned(a+16);
+	CHECK(freed);
+	// Blocks freed by other threads are poisoned too
+	std::thread([&]{ pool.deallocate(b, 64); }).join();
+	freed=!!__asan_region_is_poisoned(b, 64);
+	CHECK(freed);
+
+	Arena arena(4096);
+	char *x=static_cast<char *>(arena.allocate(100, 16));
+	open=!__asan_region_is_poisoned(x, 100);
+	bool beyond=!!__asan_address_is_poisoned(x+128);
+	CHECK(open);
+	CHECK(beyond);
+	{
+		ArenaScope scope(arena);
+		char *y=static_cast<char *>(arena.allocate(8192, 64));
+		open=!__asan_region_is_poisoned(y, 8192);
+		CHECK(open);
+	}
+	bool dropped=!!__asan_address_is_poisoned(x+112);
+	CHECK(dropped);
+	arena.reset();
+	dropped=!!__asan_address_is_poisoned(x);
+	CHECK(dropped);
+	char buffer[256];
+	{
+		Arena onstack(buffer, sizeof(buffer));
+		onstack.allocate(16);
+	}
+	bool returned=!__asan_region_is_poisoned(buffer, sizeof(buffer));
+	CHECK(returned);
+#else
+	cout << "Memory checking annotations for AddressSanitizer are not compiled into this build, so not testing them" << endl;
+#endif
+}
+
 TEST_CASE("Hash128/works", "Tests that niallsnasty128hash works")
 {
 	using namespace std;
@@ -565,4 +2843,34 @@ TEST_CASE("SHA256/works", "Tests that this SHA-256 works as per reference")
 	{
 		CHECK(hashes[n].asHexString()==tests[n][1]);
 	}
+	// Batches of more items than streams, whose tails need one or two padding blocks, and a batch of one
+	const string as(120, 'a');
+	const char *atests[][2]={
+		{"55", "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"},
+		{"56", "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a"},
+		{"63", "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34"},
+		{"64", "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"},
+		{"119", "31eba51c313a5c08226adf18d4a359cfdfd8d2e816b13f4af952f7ea6584dcfb"},
+		{"120", "2f3d335432c70b580af0e8e1b3674a7c020d683aa5f73aaaedfdc55af904c21c"},
+		{"55", "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"},
+		{"56", "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a"},
+		{"63", "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34"}
+	};
+	const size_t ano=sizeof(atests)/sizeof(atests[0]);
+	Hash256 ahashes[ano];
+	const char *adatas[ano];
+	size_t alengths[ano];
+	for(size_t n=0; n<ano; n++)
+	{
+		adatas[n]=as.data();
+		alengths[n]=(size_t) atoi(atests[n][0]);
+	}
+	Hash256::BatchAddSHA256To(ano, ahashes, adatas, alengths);
+	for(size_t n=0; n<ano; n++)
+	{
+		CHECK(ahashes[n].asHexString()==atests[n][1]);
+	}
+	Hash256 one;
+	Hash256::BatchAddSHA256To(1, &one, adatas+1, alengths+1);
+	CHECK(one.asHexString()==atests[1][1]);
 }